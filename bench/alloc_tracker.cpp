@@ -0,0 +1,132 @@
+#include "alloc_tracker.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<size_t> g_current{0};
+std::atomic<size_t> g_peak{0};
+std::atomic<size_t> g_count{0};
+
+// Each block is prefixed with its size so delete can subtract it; the
+// prefix keeps the payload at the alignment malloc guarantees
+constexpr size_t kPrefix = alignof(std::max_align_t);
+
+void* tracked_alloc(size_t size) noexcept {
+  void* raw = std::malloc(size + kPrefix);
+  if (!raw) {
+    return nullptr;
+  }
+  *static_cast<size_t*>(raw) = size;
+  g_count.fetch_add(1, std::memory_order_relaxed);
+
+  size_t now = g_current.fetch_add(size, std::memory_order_relaxed) + size;
+  size_t peak = g_peak.load(std::memory_order_relaxed);
+  while (now > peak &&
+         !g_peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+  }
+  return static_cast<char*>(raw) + kPrefix;
+}
+
+void tracked_free(void* ptr) noexcept {
+  if (!ptr) {
+    return;
+  }
+  void* raw = static_cast<char*>(ptr) - kPrefix;
+  g_current.fetch_sub(*static_cast<size_t*>(raw), std::memory_order_relaxed);
+  std::free(raw);
+}
+
+void* throwing_alloc(size_t size) {
+  if (void* ptr = tracked_alloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+}  // namespace
+
+namespace alloc_tracker {
+
+size_t current_bytes() { return g_current.load(std::memory_order_relaxed); }
+
+size_t peak_bytes() { return g_peak.load(std::memory_order_relaxed); }
+
+size_t allocation_count() { return g_count.load(std::memory_order_relaxed); }
+
+void reset_peak() { g_peak.store(current_bytes(), std::memory_order_relaxed); }
+
+size_t peak_rss_bytes() {
+#if defined(__unix__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return static_cast<size_t>(usage.ru_maxrss);  // bytes
+#else
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;  // KiB
+#endif
+#else
+  return 0;
+#endif
+}
+
+size_t current_rss_bytes() {
+#if defined(__linux__)
+  // Second field of statm: resident pages
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0;
+  size_t resident_pages = 0;
+  if (!(statm >> total_pages >> resident_pages)) {
+    return 0;
+  }
+  return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+  return 0;
+#endif
+}
+
+bool reset_peak_rss() {
+#if defined(__linux__)
+  // "5" resets the high-water mark that ru_maxrss reports
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.flush();
+  return static_cast<bool>(clear_refs);
+#else
+  return false;
+#endif
+}
+
+}  // namespace alloc_tracker
+
+// Over-aligned allocations keep the library's own operators; nothing in
+// the codec asks for more than max_align_t
+void* operator new(size_t size) { return throwing_alloc(size); }
+void* operator new[](size_t size) { return throwing_alloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return tracked_alloc(size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return tracked_alloc(size);
+}
+
+void operator delete(void* ptr) noexcept { tracked_free(ptr); }
+void operator delete[](void* ptr) noexcept { tracked_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  tracked_free(ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  tracked_free(ptr);
+}
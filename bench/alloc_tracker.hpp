@@ -0,0 +1,28 @@
+#ifndef ALLOC_TRACKER_HPP
+#define ALLOC_TRACKER_HPP
+
+#include <cstddef>
+
+// Heap use of the bench process. alloc_tracker.cpp replaces the global
+// operator new and delete to keep a running total, so a stage's peak is
+// measured by resetting the high-water mark before it and reading it after.
+namespace alloc_tracker {
+
+size_t current_bytes();
+size_t peak_bytes();
+// Allocations made so far, for counting those of one call
+size_t allocation_count();
+// Start a new high-water mark at the current total
+void reset_peak();
+
+// Peak resident set size of the process so far, 0 where unsupported
+size_t peak_rss_bytes();
+// Resident set size right now, 0 where unsupported
+size_t current_rss_bytes();
+// Restart the peak at the current resident set; false where the kernel
+// does not allow it (only Linux does), leaving the peak of the process
+bool reset_peak_rss();
+
+}  // namespace alloc_tracker
+
+#endif
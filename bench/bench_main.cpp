@@ -0,0 +1,114 @@
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/parse_number.hpp"
+
+namespace {
+
+struct Benchmark {
+  const char* name;
+  void (*run)(const BenchOptions& options);
+};
+
+const Benchmark kBenchmarks[] = {
+    {"decode", run_decode_bench},
+    {"encode", run_encode_bench},
+    {"bitio", run_bitio_bench},
+    {"scaling", run_scaling_bench},
+    {"histogram", run_histogram_bench},
+    {"length_limit", run_length_limit_bench},
+    {"tree", run_tree_bench},
+    {"latency", run_latency_bench},
+    {"dictionary", run_dictionary_bench},
+    {"context", run_context_bench},
+    {"interleave", run_interleave_bench},
+    {"progress", run_progress_bench},
+    {"memory", run_memory_bench},
+    {"suite", run_suite_bench},
+};
+
+void print_help() {
+  std::cout << "Usage: quickcompress_bench [options] [benchmark...]\n"
+            << "Options:\n"
+            << "  -s, --size <MiB>     Generated input size (default: 16)\n"
+            << "  -r, --reps <num>     Best-of repetitions (default: 3)\n"
+            << "  -t, --threads <num>  Most threads to scale to (default: all)\n"
+            << "  -j, --json <file>    Also write suite results as JSON\n"
+            << "  -h, --help           Show this help message\n"
+            << "Benchmarks:\n";
+  for (const auto& benchmark : kBenchmarks) {
+    std::cout << "  " << benchmark.name << "\n";
+  }
+}
+
+// A whole number above zero; false for anything else
+template <typename T>
+bool parse_positive(const std::string& text, T& value) {
+  T parsed = 0;
+  if (!parse_number(text, parsed) || parsed <= 0) {
+    return false;
+  }
+  value = parsed;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchOptions options;
+  std::vector<std::string> selected;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if ((arg == "-s" || arg == "--size") && i + 1 < argc) {
+      size_t mib = 0;
+      if (!parse_positive(argv[++i], mib) ||
+          mib > std::numeric_limits<size_t>::max() / (1024 * 1024)) {
+        std::cerr << "Error: Invalid input size '" << argv[i] << "'.\n";
+        return 1;
+      }
+      options.input_size = mib * 1024 * 1024;
+    } else if ((arg == "-r" || arg == "--reps") && i + 1 < argc) {
+      if (!parse_positive(argv[++i], options.repetitions)) {
+        std::cerr << "Error: Invalid number of repetitions '" << argv[i]
+                  << "'.\n";
+        return 1;
+      }
+    } else if ((arg == "-t" || arg == "--threads") && i + 1 < argc) {
+      if (!parse_positive(argv[++i], options.max_threads)) {
+        std::cerr << "Error: Invalid number of threads '" << argv[i]
+                  << "'.\n";
+        return 1;
+      }
+    } else if ((arg == "-j" || arg == "--json") && i + 1 < argc) {
+      options.json_file = argv[++i];
+    } else if (arg == "-h" || arg == "--help") {
+      print_help();
+      return 0;
+    } else {
+      selected.push_back(arg);
+    }
+  }
+
+  try {
+    for (const auto& benchmark : kBenchmarks) {
+      bool wanted = selected.empty();
+      for (const auto& name : selected) {
+        wanted = wanted || name == benchmark.name;
+      }
+      if (wanted) {
+        std::cout << "=== " << benchmark.name << " ===\n";
+        benchmark.run(options);
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+
+  return 0;
+}
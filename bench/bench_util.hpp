@@ -0,0 +1,212 @@
+#ifndef BENCH_UTIL_HPP
+#define BENCH_UTIL_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+struct BenchOptions {
+  size_t input_size = 16 * 1024 * 1024;  // bytes of generated input
+  int repetitions = 3;                   // best-of runs per measurement
+  int max_threads = 0;                   // 0 means hardware concurrency
+  std::string json_file;                 // machine-readable results, if set
+};
+
+class Timer {
+ public:
+  Timer() : start_(std::chrono::steady_clock::now()) {}
+
+  double seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start_)
+        .count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Run fn repetitions times and return the fastest wall time in seconds
+template <typename Fn>
+double best_of(int repetitions, Fn&& fn) {
+  double best = 0.0;
+  for (int i = 0; i < repetitions; ++i) {
+    Timer timer;
+    fn();
+    double elapsed = timer.seconds();
+    if (i == 0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+  return best;
+}
+
+inline double megabytes_per_second(size_t bytes, double seconds) {
+  return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+inline void report(const std::string& name, size_t bytes, double seconds) {
+  std::cout << std::left << std::setw(36) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(1)
+            << megabytes_per_second(bytes, seconds) << " MB/s\n";
+}
+
+inline void report_gb(const std::string& name, size_t bytes, double seconds) {
+  std::cout << std::left << std::setw(36) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(2)
+            << megabytes_per_second(bytes, seconds) / 1024.0 << " GB/s\n";
+}
+
+// English-like text built from a fixed vocabulary with skewed word choice
+inline std::vector<uint8_t> make_text_corpus(size_t size, uint32_t seed = 1) {
+  static const char* const kWords[] = {
+      "the",     "of",      "and",    "to",       "in",      "is",
+      "that",    "for",     "it",     "as",       "was",     "with",
+      "be",      "by",      "on",     "not",      "he",      "this",
+      "are",     "or",      "his",    "from",     "at",      "which",
+      "but",     "have",    "an",     "had",      "they",    "you",
+      "were",    "their",   "one",    "all",      "we",      "can",
+      "her",     "has",     "there",  "been",     "if",      "more",
+      "when",    "will",    "would",  "who",      "so",      "no",
+      "compress", "huffman", "stream", "frequency", "encoder", "decoder",
+      "ERROR",   "WARN",    "INFO",   "request",  "latency", "12345"};
+  const size_t num_words = sizeof(kWords) / sizeof(kWords[0]);
+
+  std::mt19937 rng(seed);
+  std::geometric_distribution<size_t> pick(0.08);
+
+  std::vector<uint8_t> data;
+  data.reserve(size);
+  while (data.size() < size) {
+    const char* word = kWords[pick(rng) % num_words];
+    for (const char* c = word; *c && data.size() < size; ++c) {
+      data.push_back(static_cast<uint8_t>(*c));
+    }
+    if (data.size() < size) {
+      data.push_back((rng() % 12 == 0) ? '\n' : ' ');
+    }
+  }
+  return data;
+}
+
+// C-like source: indented statements over a small identifier set, the
+// kind of input where the previous byte predicts the next one well
+inline std::vector<uint8_t> make_source_corpus(size_t size,
+                                               uint32_t seed = 1) {
+  static const char* const kNames[] = {
+      "size",   "count", "offset", "buffer", "result", "index", "table",
+      "header", "block", "length", "symbol", "input",  "output", "codec"};
+  static const char* const kTypes[] = {"size_t", "uint8_t", "uint32_t",
+                                       "auto",   "int",     "bool"};
+  const size_t num_names = sizeof(kNames) / sizeof(kNames[0]);
+  const size_t num_types = sizeof(kTypes) / sizeof(kTypes[0]);
+
+  std::mt19937 rng(seed);
+  auto name = [&] { return std::string(kNames[rng() % num_names]); };
+
+  std::string text;
+  int depth = 0;
+  while (text.size() < size) {
+    std::string line;
+    switch (depth >= 6 ? 7 : rng() % 8) {
+      case 0:
+        line = std::string(kTypes[rng() % num_types]) + " " + name() + " = " +
+               name() + " + " + std::to_string(rng() % 64) + ";";
+        break;
+      case 1:
+        line = "if (" + name() + " < " + name() + ".size()) {";
+        break;
+      case 2:
+        line = "for (size_t i = 0; i < " + name() + "; ++i) {";
+        break;
+      case 3:
+        line = name() + "[i] = " + name() + "(" + name() + ", " + name() +
+               ");";
+        break;
+      case 4:
+        line = "// Update the " + name() + " before the " + name();
+        break;
+      case 5:
+        line = "return " + name() + ";";
+        break;
+      default:
+        line = depth > 0 ? "}" : "void " + name() + "_" + name() + "() {";
+        break;
+    }
+    if (line == "}") {
+      --depth;
+    }
+    text += std::string(2 * depth, ' ') + line + "\n";
+    if (line.back() == '{') {
+      ++depth;
+    }
+  }
+  text.resize(size);
+  return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+// Log records from a few templates with small varying fields, like
+// machine-generated output where long runs repeat almost verbatim
+inline std::vector<uint8_t> make_repetitive_corpus(size_t size,
+                                                   uint32_t seed = 1) {
+  static const char* const kTemplates[] = {
+      "2024-05-01T12:00:00Z INFO  request served status=200 path=/api/v1/",
+      "2024-05-01T12:00:00Z INFO  cache hit key=session:",
+      "2024-05-01T12:00:00Z WARN  slow query took_ms=",
+  };
+  const size_t num_templates = sizeof(kTemplates) / sizeof(kTemplates[0]);
+
+  std::mt19937 rng(seed);
+  std::string text;
+  while (text.size() < size) {
+    // Most records repeat the first template
+    size_t pick = rng() % 8;
+    text += kTemplates[pick < 6 ? 0 : 1 + pick % (num_templates - 1)];
+    text += std::to_string(rng() % 100) + "\n";
+  }
+  text.resize(size);
+  return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+// Uniform random bytes, which no prefix code can shrink
+inline std::vector<uint8_t> make_random_corpus(size_t size,
+                                               uint32_t seed = 1) {
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> data(size);
+  for (auto& byte : data) {
+    byte = static_cast<uint8_t>(rng());
+  }
+  return data;
+}
+
+// Geometrically distributed bytes: byte n appears about p(1-p)^n of the
+// time, which drives Huffman code lengths well past 20 bits
+inline std::vector<uint8_t> make_skewed_corpus(size_t size, double p = 0.5,
+                                               uint32_t seed = 1) {
+  std::mt19937 rng(seed);
+  std::geometric_distribution<int> pick(p);
+
+  std::vector<uint8_t> data(size);
+  for (auto& byte : data) {
+    byte = static_cast<uint8_t>(std::min(pick(rng), 255));
+  }
+  return data;
+}
+
+inline std::map<uint8_t, uint64_t> count_frequencies(
+    const std::vector<uint8_t>& data) {
+  std::map<uint8_t, uint64_t> frequencies;
+  for (uint8_t byte : data) {
+    frequencies[byte]++;
+  }
+  return frequencies;
+}
+
+#endif
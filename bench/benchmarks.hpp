@@ -0,0 +1,24 @@
+#ifndef BENCHMARKS_HPP
+#define BENCHMARKS_HPP
+
+#include "bench_util.hpp"
+
+// Each benchmark prints one line per measured variant
+void run_decode_bench(const BenchOptions& options);
+void run_encode_bench(const BenchOptions& options);
+void run_bitio_bench(const BenchOptions& options);
+void run_scaling_bench(const BenchOptions& options);
+void run_histogram_bench(const BenchOptions& options);
+void run_length_limit_bench(const BenchOptions& options);
+void run_tree_bench(const BenchOptions& options);
+void run_latency_bench(const BenchOptions& options);
+void run_dictionary_bench(const BenchOptions& options);
+void run_context_bench(const BenchOptions& options);
+void run_interleave_bench(const BenchOptions& options);
+void run_progress_bench(const BenchOptions& options);
+// Peak RSS while coding large files on disk, at two sizes
+void run_memory_bench(const BenchOptions& options);
+// Every stage on every generated corpus; also writes options.json_file
+void run_suite_bench(const BenchOptions& options);
+
+#endif
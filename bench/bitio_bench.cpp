@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/bit_stream.hpp"
+#include "core/fast_bit_stream.hpp"
+
+void run_bitio_bench(const BenchOptions& options) {
+  // Variable-width fields shaped like Huffman codes on text
+  std::mt19937 rng(7);
+  std::vector<uint32_t> values(options.input_size / 4);
+  std::vector<int> widths(values.size());
+  uint64_t total_bits = 0;
+  for (size_t i = 0; i < values.size(); ++i) {
+    widths[i] = 3 + static_cast<int>(rng() % 10);
+    values[i] = rng() & ((1u << widths[i]) - 1);
+    total_bits += widths[i];
+  }
+  size_t total_bytes = (total_bits + 7) / 8;
+
+  BitStream bit_stream;
+  double stream_write = best_of(options.repetitions, [&] {
+    bit_stream.clear();
+    for (size_t i = 0; i < values.size(); ++i) {
+      bit_stream.write_bits(values[i], widths[i]);
+    }
+  });
+  report("bitio/bitstream_write", total_bytes, stream_write);
+
+  FastBitWriter writer;
+  double fast_write = best_of(options.repetitions, [&] {
+    writer.clear();
+    writer.reserve(total_bytes);
+    for (size_t i = 0; i < values.size(); ++i) {
+      writer.write_bits(values[i], widths[i]);
+    }
+    writer.flush();
+  });
+  report("bitio/fast_write", total_bytes, fast_write);
+
+  auto expected = bit_stream.get_buffer();
+  if (!std::equal(expected.begin(), expected.end(), writer.data()) ||
+      expected.size() != writer.byte_size()) {
+    throw std::runtime_error("bitio bench: writer layouts differ");
+  }
+
+  double stream_read = best_of(options.repetitions, [&] {
+    bit_stream.load_from_buffer(expected);
+    for (size_t i = 0; i < values.size(); ++i) {
+      if (bit_stream.read_bits(widths[i]) != values[i]) {
+        throw std::runtime_error("bitio bench: bitstream read mismatch");
+      }
+    }
+  });
+  report("bitio/bitstream_read", total_bytes, stream_read);
+
+  double fast_read = best_of(options.repetitions, [&] {
+    FastBitReader reader(expected.data(), expected.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      reader.refill();
+      if (reader.peek_bits(widths[i]) != values[i]) {
+        throw std::runtime_error("bitio bench: fast read mismatch");
+      }
+      reader.consume_bits(widths[i]);
+    }
+  });
+  report("bitio/fast_read", total_bytes, fast_read);
+}
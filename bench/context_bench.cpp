@@ -0,0 +1,54 @@
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/memory_codec.hpp"
+
+namespace {
+
+void run_variant(const std::string& name, const std::vector<uint8_t>& input,
+                 bool context_mode, int max_code_length,
+                 const BenchOptions& options) {
+  MemoryCodec codec;
+  codec.set_context_mode(context_mode);
+  codec.set_max_code_length(max_code_length);
+
+  std::vector<uint8_t> packed;
+  std::vector<uint8_t> restored;
+  double compress_seconds = best_of(
+      options.repetitions,
+      [&] { codec.compress(input.data(), input.size(), packed); });
+  double decompress_seconds = best_of(
+      options.repetitions,
+      [&] { codec.decompress(packed.data(), packed.size(), restored); });
+  if (restored != input) {
+    throw std::runtime_error("context bench: output mismatch");
+  }
+
+  std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+            << "ratio " << std::setprecision(3)
+            << static_cast<double>(packed.size()) / input.size()
+            << "  compress " << std::setprecision(1) << std::setw(7)
+            << megabytes_per_second(input.size(), compress_seconds)
+            << " MB/s  decompress " << std::setw(7)
+            << megabytes_per_second(input.size(), decompress_seconds)
+            << " MB/s\n";
+}
+
+void run_corpus(const std::string& name, const std::vector<uint8_t>& input,
+                const BenchOptions& options) {
+  run_variant(name + "/order0", input, false, 0, options);
+  run_variant(name + "/order1", input, true, 0, options);
+  run_variant(name + "/order0/max11", input, false, 11, options);
+  run_variant(name + "/order1/max11", input, true, 11, options);
+}
+
+}  // namespace
+
+void run_context_bench(const BenchOptions& options) {
+  run_corpus("text", make_text_corpus(options.input_size), options);
+  run_corpus("source", make_source_corpus(options.input_size), options);
+}
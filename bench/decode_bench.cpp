@@ -0,0 +1,65 @@
+#include <stdexcept>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/bit_stream.hpp"
+#include "core/fast_bit_stream.hpp"
+#include "core/huffman_decoder.hpp"
+#include "core/huffman_tree.hpp"
+
+void run_decode_bench(const BenchOptions& options) {
+  auto input = make_text_corpus(options.input_size);
+
+  HuffmanTree tree;
+  tree.build_tree(count_frequencies(input));
+  auto codes = tree.generate_codes();
+
+  BitStream encoded;
+  for (uint8_t byte : input) {
+    for (char c : codes[byte]) {
+      encoded.write_bit(c == '1');
+    }
+  }
+  auto encoded_bytes = encoded.get_buffer();
+
+  std::vector<uint8_t> output(input.size());
+  BitStream reader;
+
+  double tree_seconds = best_of(options.repetitions, [&] {
+    reader.load_from_buffer(encoded_bytes);
+    for (size_t i = 0; i < output.size(); ++i) {
+      output[i] = tree.decode_byte(reader);
+    }
+  });
+  if (output != input) {
+    throw std::runtime_error("decode bench: tree walk output mismatch");
+  }
+  report("decode/tree_walk", input.size(), tree_seconds);
+
+  HuffmanDecoder decoder;
+  double build_seconds = best_of(options.repetitions, [&] {
+    decoder.build(tree);
+  });
+
+  std::fill(output.begin(), output.end(), 0);
+  double table_seconds = best_of(options.repetitions, [&] {
+    reader.load_from_buffer(encoded_bytes);
+    decoder.decode(reader, output.data(), output.size());
+  });
+  if (output != input) {
+    throw std::runtime_error("decode bench: table output mismatch");
+  }
+  report("decode/table", input.size(), table_seconds);
+
+  std::fill(output.begin(), output.end(), 0);
+  double fast_seconds = best_of(options.repetitions, [&] {
+    FastBitReader fast_reader(encoded_bytes.data(), encoded_bytes.size());
+    decoder.decode(fast_reader, output.data(), output.size());
+  });
+  if (output != input) {
+    throw std::runtime_error("decode bench: fast reader output mismatch");
+  }
+  report("decode/table+fast_reader", input.size(), fast_seconds);
+
+  std::cout << "table build: " << build_seconds * 1e6 << " us\n";
+}
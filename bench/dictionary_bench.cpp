@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/memory_codec.hpp"
+#include "core/shared_table.hpp"
+
+namespace {
+
+constexpr size_t kTrainingRecords = 200;
+constexpr size_t kTestRecords = 2000;
+
+struct Record {
+  size_t offset;
+  size_t size;
+};
+
+struct Result {
+  uint64_t original_bytes = 0;
+  uint64_t compressed_bytes = 0;
+  std::vector<double> compress_times;
+  std::vector<double> decompress_times;
+};
+
+double median(std::vector<double>& samples) {
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+Result run_records(MemoryCodec& codec, const std::vector<uint8_t>& corpus,
+                   const std::vector<Record>& records) {
+  Result result;
+  std::vector<uint8_t> packed;
+  std::vector<uint8_t> restored;
+  for (const auto& record : records) {
+    const uint8_t* data = corpus.data() + record.offset;
+
+    Timer compress_timer;
+    codec.compress(data, record.size, packed);
+    result.compress_times.push_back(compress_timer.seconds());
+
+    Timer decompress_timer;
+    codec.decompress(packed.data(), packed.size(), restored);
+    result.decompress_times.push_back(decompress_timer.seconds());
+
+    if (restored.size() != record.size ||
+        !std::equal(restored.begin(), restored.end(), data)) {
+      throw std::runtime_error("dictionary bench: output mismatch");
+    }
+    result.original_bytes += record.size;
+    result.compressed_bytes += packed.size();
+  }
+  return result;
+}
+
+void report_result(const std::string& name, Result& result) {
+  std::cout << std::left << std::setw(36) << name << std::right << std::fixed
+            << "ratio " << std::setprecision(3)
+            << static_cast<double>(result.compressed_bytes) /
+                   result.original_bytes
+            << "  compress p50 " << std::setprecision(1) << std::setw(6)
+            << median(result.compress_times) * 1e6 << " us  decompress p50 "
+            << std::setw(6) << median(result.decompress_times) * 1e6
+            << " us\n";
+}
+
+}  // namespace
+
+void run_dictionary_bench(const BenchOptions& options) {
+  // Small records cut from one homogeneous corpus; the first ones train
+  // the table, the rest are compressed one at a time
+  auto corpus = make_text_corpus(options.input_size);
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<size_t> record_size(128, 2048);
+
+  std::vector<Record> records;
+  for (size_t i = 0; i < kTrainingRecords + kTestRecords; ++i) {
+    size_t size = record_size(rng);
+    size_t offset = rng() % (corpus.size() - size);
+    records.push_back(Record{offset, size});
+  }
+  std::vector<Record> training(records.begin(),
+                               records.begin() + kTrainingRecords);
+  std::vector<Record> test(records.begin() + kTrainingRecords, records.end());
+
+  auto table = std::make_shared<SharedTable>();
+  for (const auto& record : training) {
+    table->add_sample(corpus.data() + record.offset, record.size);
+  }
+  table->train();
+
+  MemoryCodec per_block;
+  Result own_tables = run_records(per_block, corpus, test);
+  report_result("dictionary/per_block_tables", own_tables);
+
+  MemoryCodec shared;
+  shared.set_shared_table(table);
+  Result shared_table = run_records(shared, corpus, test);
+  report_result("dictionary/shared_table", shared_table);
+}
@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/bit_stream.hpp"
+#include "core/code_table.hpp"
+#include "core/fast_bit_stream.hpp"
+#include "core/huffman_tree.hpp"
+
+void run_encode_bench(const BenchOptions& options) {
+  auto input = make_text_corpus(options.input_size);
+
+  HuffmanTree tree;
+  tree.build_tree(count_frequencies(input));
+
+  // Baseline: code strings looked up in a map, one write_bit per character
+  auto codes = tree.generate_codes();
+  BitStream string_stream;
+  double string_seconds = best_of(options.repetitions, [&] {
+    string_stream.clear();
+    for (uint8_t byte : input) {
+      auto it = codes.find(byte);
+      for (char c : it->second) {
+        string_stream.write_bit(c == '1');
+      }
+    }
+  });
+  report("encode/string_map+bitstream", input.size(), string_seconds);
+
+  CodeTable table = tree.code_table();
+  FastBitWriter writer;
+  double table_seconds = best_of(options.repetitions, [&] {
+    writer.clear();
+    for (uint8_t byte : input) {
+      const Code& code = table[byte];
+      writer.write_bits(code.bits, code.length);
+    }
+    writer.flush();
+  });
+  report("encode/code_table+fast_writer", input.size(), table_seconds);
+
+  auto expected = string_stream.get_buffer();
+  if (expected.size() != writer.byte_size() ||
+      !std::equal(expected.begin(), expected.end(), writer.data())) {
+    throw std::runtime_error("encode bench: code table output mismatch");
+  }
+
+  double build_seconds =
+      best_of(options.repetitions, [&] { codes = tree.generate_codes(); });
+  double table_build_seconds =
+      best_of(options.repetitions, [&] { table = tree.code_table(); });
+  std::cout << "string map build: " << build_seconds * 1e6 << " us\n"
+            << "code table build: " << table_build_seconds * 1e6 << " us\n";
+}
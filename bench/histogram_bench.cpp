@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <map>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/frequency_analyzer.hpp"
+
+void run_histogram_bench(const BenchOptions& options) {
+  auto text = make_text_corpus(options.input_size);
+  // A single repeated byte is the worst case for one shared counter table
+  std::vector<uint8_t> run(options.input_size, 'A');
+
+  int threads = options.max_threads > 0
+                    ? options.max_threads
+                    : static_cast<int>(std::thread::hardware_concurrency());
+
+  for (const auto* input : {&text, &run}) {
+    const char* corpus = input == &text ? "text" : "run";
+
+    std::map<uint8_t, uint64_t> by_map;
+    double map_seconds = best_of(options.repetitions, [&] {
+      by_map.clear();
+      for (uint8_t byte : *input) {
+        by_map[byte]++;
+      }
+    });
+    report_gb(std::string("histogram/") + corpus + "/std_map", input->size(),
+              map_seconds);
+
+    FrequencyAnalyzer::Histogram single{};
+    double single_seconds = best_of(options.repetitions, [&] {
+      single.fill(0);
+      for (uint8_t byte : *input) {
+        single[byte]++;
+      }
+    });
+    report_gb(std::string("histogram/") + corpus + "/one_table",
+              input->size(), single_seconds);
+
+    FrequencyAnalyzer::Histogram kernel{};
+    double kernel_seconds = best_of(options.repetitions, [&] {
+      kernel.fill(0);
+      FrequencyAnalyzer::count(input->data(), input->size(), kernel);
+    });
+    report_gb(std::string("histogram/") + corpus + "/four_tables",
+              input->size(), kernel_seconds);
+
+    FrequencyAnalyzer::Histogram parallel{};
+    double parallel_seconds = best_of(options.repetitions, [&] {
+      parallel = FrequencyAnalyzer::count_parallel(input->data(),
+                                                   input->size(), threads);
+    });
+    report_gb(std::string("histogram/") + corpus +
+                  "/parallel_threads=" + std::to_string(threads),
+              input->size(), parallel_seconds);
+
+    if (FrequencyAnalyzer::to_map(kernel) != by_map || kernel != single ||
+        parallel != single) {
+      throw std::runtime_error("histogram bench: counts differ");
+    }
+  }
+}
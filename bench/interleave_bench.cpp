@@ -0,0 +1,86 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/canonical_code.hpp"
+#include "core/container_format.hpp"
+#include "core/fast_bit_stream.hpp"
+#include "core/huffman_decoder.hpp"
+#include "core/huffman_tree.hpp"
+
+namespace {
+
+std::vector<uint8_t> encode_stream(const CanonicalCode& code,
+                                   const uint8_t* data, size_t size) {
+  FastBitWriter writer;
+  for (size_t i = 0; i < size; ++i) {
+    writer.write_bits(code.code(data[i]), code.length(data[i]));
+  }
+  writer.flush();
+  return std::vector<uint8_t>(writer.data(),
+                              writer.data() + writer.byte_size());
+}
+
+void run_code(const std::string& name, const std::vector<uint8_t>& input,
+              const CanonicalCode& code, const BenchOptions& options) {
+  HuffmanDecoder decoder;
+  decoder.build(code);
+  std::vector<uint8_t> output(input.size());
+
+  auto single = encode_stream(code, input.data(), input.size());
+  double single_seconds = best_of(options.repetitions, [&] {
+    FastBitReader reader(single.data(), single.size());
+    decoder.decode(reader, output.data(), output.size());
+  });
+  if (output != input) {
+    throw std::runtime_error("interleave bench: single stream mismatch");
+  }
+  report_gb("interleave/" + name + "/1_stream", input.size(), single_seconds);
+
+  // Same split as kHuffmanInterleaved blocks
+  size_t run = input.size() / kInterleavedStreams;
+  std::vector<std::vector<uint8_t>> streams;
+  for (size_t stream = 0; stream < kInterleavedStreams; ++stream) {
+    size_t begin = stream * run;
+    size_t end = stream + 1 < kInterleavedStreams ? begin + run : input.size();
+    streams.push_back(encode_stream(code, input.data() + begin, end - begin));
+  }
+
+  std::fill(output.begin(), output.end(), 0);
+  double interleaved_seconds = best_of(options.repetitions, [&] {
+    FastBitReader readers[kInterleavedStreams];
+    uint8_t* outs[kInterleavedStreams];
+    for (size_t stream = 0; stream < kInterleavedStreams; ++stream) {
+      readers[stream].reset(streams[stream].data(), streams[stream].size());
+      outs[stream] = output.data() + stream * run;
+    }
+    decoder.decode_interleaved(readers, outs, run);
+    const size_t last = kInterleavedStreams - 1;
+    decoder.decode(readers[last], outs[last] + run,
+                   input.size() - kInterleavedStreams * run);
+  });
+  if (output != input) {
+    throw std::runtime_error("interleave bench: interleaved mismatch");
+  }
+  report_gb("interleave/" + name + "/4_streams", input.size(),
+            interleaved_seconds);
+}
+
+}  // namespace
+
+void run_interleave_bench(const BenchOptions& options) {
+  auto input = make_text_corpus(options.input_size);
+  auto frequencies = count_frequencies(input);
+
+  HuffmanTree tree;
+  tree.build_tree(frequencies);
+  CanonicalCode unbounded;
+  unbounded.assign(tree.code_lengths());
+  run_code("unbounded", input, unbounded, options);
+
+  CanonicalCode limited;
+  limited.assign(HuffmanTree::limited_code_lengths(
+      frequencies, HuffmanDecoder::kPrimaryBits));
+  run_code("max11", input, limited, options);
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "alloc_tracker.hpp"
+#include "benchmarks.hpp"
+#include "core/memory_codec.hpp"
+
+namespace {
+
+constexpr size_t kCalls = 2000;
+// Calls before allocations are counted, while the reused buffers grow
+constexpr size_t kWarmupCalls = 16;
+
+double percentile(std::vector<double>& samples, double fraction) {
+  std::sort(samples.begin(), samples.end());
+  size_t index = static_cast<size_t>(fraction * (samples.size() - 1));
+  return samples[index];
+}
+
+struct Latency {
+  std::vector<double> seconds;
+  size_t allocations = 0;  // after the warm-up calls
+};
+
+void report_latency(const std::string& name, Latency& latency) {
+  std::cout << std::left << std::setw(36) << name << std::right << std::fixed
+            << std::setprecision(1) << "p50 " << std::setw(8)
+            << percentile(latency.seconds, 0.50) * 1e6 << " us  p99 "
+            << std::setw(8) << percentile(latency.seconds, 0.99) * 1e6
+            << " us  allocs/call " << std::setprecision(2)
+            << static_cast<double>(latency.allocations) /
+                   (kCalls - kWarmupCalls)
+            << "\n";
+}
+
+// Time every call separately; reuse decides whether the context and output
+// buffers survive from one message to the next. Fresh and reused calls
+// alternate, each going first every other message, so a machine that
+// speeds up or slows down during the run skews both alike.
+void run_size(const std::vector<uint8_t>& corpus, size_t message_size) {
+  Latency compress[2];
+  Latency decompress[2];
+
+  MemoryCodec shared_codec;
+  std::vector<uint8_t> shared_packed;
+  std::vector<uint8_t> shared_restored;
+
+  for (size_t call = 0; call < kCalls; ++call) {
+    size_t offset = (call * 7919 * 64) % (corpus.size() - message_size);
+    const uint8_t* message = corpus.data() + offset;
+
+    for (size_t turn = 0; turn < 2; ++turn) {
+      const bool reuse = (call + turn) % 2 == 1;
+      const bool counted = call >= kWarmupCalls;
+
+      // A fresh context is built and destroyed inside the timed call
+      std::vector<uint8_t> fresh_packed;
+      std::vector<uint8_t>& packed = reuse ? shared_packed : fresh_packed;
+      size_t allocations = alloc_tracker::allocation_count();
+      Timer compress_timer;
+      if (reuse) {
+        shared_codec.compress(message, message_size, packed);
+      } else {
+        MemoryCodec fresh_codec;
+        fresh_codec.compress(message, message_size, packed);
+      }
+      compress[reuse].seconds.push_back(compress_timer.seconds());
+      if (counted) {
+        compress[reuse].allocations +=
+            alloc_tracker::allocation_count() - allocations;
+      }
+
+      std::vector<uint8_t> fresh_restored;
+      std::vector<uint8_t>& restored =
+          reuse ? shared_restored : fresh_restored;
+      allocations = alloc_tracker::allocation_count();
+      Timer decompress_timer;
+      if (reuse) {
+        shared_codec.decompress(packed.data(), packed.size(), restored);
+      } else {
+        MemoryCodec fresh_decoder;
+        fresh_decoder.decompress(packed.data(), packed.size(), restored);
+      }
+      decompress[reuse].seconds.push_back(decompress_timer.seconds());
+      if (counted) {
+        decompress[reuse].allocations +=
+            alloc_tracker::allocation_count() - allocations;
+      }
+
+      if (restored.size() != message_size ||
+          !std::equal(restored.begin(), restored.end(), message)) {
+        throw std::runtime_error("latency bench: output mismatch");
+      }
+    }
+  }
+
+  for (int reuse = 0; reuse < 2; ++reuse) {
+    std::string label = std::to_string(message_size) + "B/" +
+                        (reuse ? "reused" : "fresh");
+    report_latency("compress/" + label, compress[reuse]);
+    report_latency("decompress/" + label, decompress[reuse]);
+  }
+}
+
+}  // namespace
+
+void run_latency_bench(const BenchOptions& options) {
+  static const size_t kMessageSizes[] = {256, 1024, 4096, 16384, 65536};
+
+  auto corpus = make_text_corpus(
+      std::max<size_t>(options.input_size, 2 * kMessageSizes[4]));
+  for (size_t message_size : kMessageSizes) {
+    run_size(corpus, message_size);
+  }
+}
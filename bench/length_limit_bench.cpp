@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/block_codec.hpp"
+#include "core/container_format.hpp"
+
+namespace {
+
+constexpr size_t kBlockSize = 1 << 20;
+
+// Encode input as a sequence of container blocks with the given limit
+std::vector<uint8_t> encode_blocks(BlockCodec& codec,
+                                   const std::vector<uint8_t>& input) {
+  std::vector<uint8_t> encoded;
+  for (size_t offset = 0; offset < input.size(); offset += kBlockSize) {
+    size_t size = std::min(kBlockSize, input.size() - offset);
+    codec.encode_block(input.data() + offset, size, encoded);
+  }
+  return encoded;
+}
+
+void decode_blocks(BlockCodec& codec, const std::vector<uint8_t>& encoded,
+                   std::vector<uint8_t>& output) {
+  size_t in = 0;
+  size_t out = 0;
+  while (in < encoded.size()) {
+    BlockHeader header = load_block_header(encoded.data() + in);
+    in += BlockHeader::kSize;
+    codec.decode_block(header, encoded.data() + in, output.data() + out);
+    in += header.compressed_size;
+    out += header.original_size;
+  }
+}
+
+void run_corpus(const std::string& name, const std::vector<uint8_t>& input,
+                const BenchOptions& options) {
+  static const int kLimits[] = {0, 15, 12, 11, 9};
+
+  size_t unbounded_size = 0;
+  std::vector<uint8_t> output(input.size());
+  for (int limit : kLimits) {
+    BlockCodec codec;
+    codec.set_max_code_length(limit);
+    auto encoded = encode_blocks(codec, input);
+    if (limit == 0) {
+      unbounded_size = encoded.size();
+    }
+
+    std::fill(output.begin(), output.end(), 0);
+    double seconds = best_of(options.repetitions,
+                             [&] { decode_blocks(codec, encoded, output); });
+    if (output != input) {
+      throw std::runtime_error("length limit bench: output mismatch");
+    }
+
+    std::string label = name + "/" +
+                        (limit == 0 ? std::string("unbounded")
+                                    : "max" + std::to_string(limit));
+    report("decode/" + label, input.size(), seconds);
+    std::cout << "  size " << encoded.size() << " bytes, ratio "
+              << std::setprecision(4)
+              << static_cast<double>(encoded.size()) / input.size()
+              << ", cost " << std::setprecision(3)
+              << 100.0 * (static_cast<double>(encoded.size()) -
+                          unbounded_size) /
+                     unbounded_size
+              << "% vs unbounded\n";
+  }
+}
+
+}  // namespace
+
+void run_length_limit_bench(const BenchOptions& options) {
+  run_corpus("text", make_text_corpus(options.input_size), options);
+  run_corpus("skewed", make_skewed_corpus(options.input_size), options);
+}
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "alloc_tracker.hpp"
+#include "benchmarks.hpp"
+#include "core/encoder.hpp"
+
+namespace {
+
+constexpr size_t kChunkSize = 4 * 1024 * 1024;
+constexpr double kMiB = 1024.0 * 1024.0;
+// Growth from the smaller to the larger file that still counts as flat
+constexpr size_t kFlatSlack = 4 * 1024 * 1024;
+
+// Written a chunk at a time, so generating the input does not set the peak
+void write_input(const std::string& file_name, size_t size) {
+  auto chunk = make_text_corpus(kChunkSize);
+  std::ofstream out(file_name, std::ios::binary);
+  for (size_t written = 0; written < size; written += chunk.size()) {
+    out.write(reinterpret_cast<const char*>(chunk.data()),
+              std::min(chunk.size(), size - written));
+  }
+  if (!out) {
+    throw std::runtime_error("memory bench: failed to write " + file_name);
+  }
+}
+
+// Peak resident set while fn runs, above the resident set before it
+template <typename Fn>
+size_t peak_rss_growth(const std::string& name, size_t size, Fn&& fn) {
+  bool reset = alloc_tracker::reset_peak_rss();
+  size_t baseline = reset ? alloc_tracker::current_rss_bytes()
+                          : alloc_tracker::peak_rss_bytes();
+  Timer timer;
+  fn();
+  double seconds = timer.seconds();
+  size_t peak = alloc_tracker::peak_rss_bytes();
+  size_t growth = peak > baseline ? peak - baseline : 0;
+
+  std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(8) << size / kMiB
+            << " MiB  " << std::setw(8) << megabytes_per_second(size, seconds)
+            << " MB/s  peak RSS +" << std::setw(6) << growth / kMiB
+            << " MiB" << (reset ? "" : " (process peak, not reset)") << "\n";
+  return growth;
+}
+
+}  // namespace
+
+// Peak resident memory while Encoder codes files on disk of two sizes.
+// Input is memory-mapped and released behind the reader, and output goes
+// out through fixed-size buffers, so the peak should be a few blocks and
+// buffers however large the file.
+void run_memory_bench(const BenchOptions& options) {
+  const std::string input_file = "quickcompress_bench_memory.tmp";
+  const std::string compressed_file = "quickcompress_bench_memory.qcmp";
+  const std::string output_file = "quickcompress_bench_memory.out";
+
+  std::cout << "block " << Encoder::kDefaultBlockSize / 1024
+            << " KiB, buffer " << Encoder::kDefaultBufferSize / 1024
+            << " KiB, 1 thread\n";
+
+  // A fresh Encoder per run, so its buffers count towards every peak
+  auto compress = [&] {
+    Encoder encoder;
+    encoder.set_show_progress(false);
+    encoder.compress(input_file, compressed_file);
+  };
+  auto decompress = [&] {
+    Encoder encoder;
+    encoder.set_show_progress(false);
+    encoder.decompress(compressed_file, output_file);
+  };
+
+  const size_t sizes[] = {4 * options.input_size, 16 * options.input_size};
+  size_t compress_growth[2];
+  size_t decompress_growth[2];
+  for (size_t i = 0; i < 2; ++i) {
+    write_input(input_file, sizes[i]);
+    compress_growth[i] = peak_rss_growth("compress", sizes[i], compress);
+    decompress_growth[i] =
+        peak_rss_growth("decompress", sizes[i], decompress);
+  }
+  std::remove(input_file.c_str());
+  std::remove(compressed_file.c_str());
+  std::remove(output_file.c_str());
+
+  // Four times the input should leave the peak where it was
+  bool flat = compress_growth[1] <= compress_growth[0] + kFlatSlack &&
+              decompress_growth[1] <= decompress_growth[0] + kFlatSlack;
+  std::cout << "peak RSS " << (flat ? "flat" : "GROWS") << " with input size\n";
+}
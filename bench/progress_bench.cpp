@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/code_table.hpp"
+#include "core/fast_bit_stream.hpp"
+#include "core/huffman_decoder.hpp"
+#include "core/huffman_tree.hpp"
+#include "core/progress_reporter.hpp"
+
+namespace {
+
+// Decoded between progress updates, like a legacy-format refill
+constexpr size_t kBatchSize = 16 * 1024;
+
+}  // namespace
+
+void run_progress_bench(const BenchOptions& options) {
+  auto input = make_text_corpus(options.input_size);
+
+  HuffmanTree tree;
+  tree.build_tree(count_frequencies(input));
+  CodeTable table = tree.code_table();
+  FastBitWriter writer;
+  for (uint8_t byte : input) {
+    writer.write_bits(table[byte].bits, table[byte].length);
+  }
+  writer.flush();
+
+  HuffmanDecoder decoder;
+  decoder.build(tree);
+  std::vector<uint8_t> output(input.size());
+
+  // The bar draws into a stream that discards everything, so only the
+  // counting and the sampler thread are measured
+  std::ostream discard(nullptr);
+  auto decode = [&](ProgressReporter* progress) {
+    FastBitReader reader(writer.data(), writer.byte_size());
+    for (size_t done = 0; done < output.size(); done += kBatchSize) {
+      size_t batch = std::min(kBatchSize, output.size() - done);
+      decoder.decode(reader, output.data() + done, batch);
+      if (progress) {
+        progress->add(batch);
+      }
+    }
+  };
+
+  double plain_seconds =
+      best_of(options.repetitions, [&] { decode(nullptr); });
+  report("progress/none", input.size(), plain_seconds);
+
+  double sampled_seconds = best_of(options.repetitions, [&] {
+    ProgressReporter progress(ProgressReporter::Kind::kDecompress,
+                              input.size(), true, discard);
+    decode(&progress);
+    progress.finish();
+  });
+  report("progress/counter+sampler", input.size(), sampled_seconds);
+
+  if (output != input) {
+    throw std::runtime_error("progress bench: output mismatch");
+  }
+}
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/encoder.hpp"
+
+void run_scaling_bench(const BenchOptions& options) {
+  const std::string input_file = "quickcompress_bench_input.tmp";
+  const std::string compressed_file = "quickcompress_bench_input.qcmp";
+  const std::string output_file = "quickcompress_bench_output.tmp";
+
+  auto input = make_text_corpus(options.input_size);
+  {
+    std::ofstream out(input_file, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(input.data()), input.size());
+  }
+
+  int max_threads = options.max_threads > 0
+                        ? options.max_threads
+                        : static_cast<int>(std::thread::hardware_concurrency());
+  max_threads = std::max(1, max_threads);
+  std::vector<int> thread_counts;
+  for (int threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  Encoder encoder;
+  for (int threads : thread_counts) {
+    encoder.set_num_threads(threads);
+    double seconds = best_of(options.repetitions, [&] {
+      encoder.compress(input_file, compressed_file);
+    });
+    report("compress/threads=" + std::to_string(threads), input.size(),
+           seconds);
+  }
+
+  for (int threads : thread_counts) {
+    encoder.set_num_threads(threads);
+    double seconds = best_of(options.repetitions, [&] {
+      encoder.decompress(compressed_file, output_file);
+    });
+    report("decompress/threads=" + std::to_string(threads), input.size(),
+           seconds);
+
+    std::ifstream in(output_file, std::ios::binary);
+    std::vector<uint8_t> output((std::istreambuf_iterator<char>(in)),
+                                std::istreambuf_iterator<char>());
+    if (output != input) {
+      throw std::runtime_error("scaling bench: threads=" +
+                               std::to_string(threads) + " output mismatch");
+    }
+  }
+
+  std::remove(input_file.c_str());
+  std::remove(compressed_file.c_str());
+  std::remove(output_file.c_str());
+}
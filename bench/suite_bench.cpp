@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "alloc_tracker.hpp"
+#include "benchmarks.hpp"
+#include "core/code_table.hpp"
+#include "core/fast_bit_stream.hpp"
+#include "core/frequency_analyzer.hpp"
+#include "core/huffman_decoder.hpp"
+#include "core/huffman_tree.hpp"
+#include "core/memory_codec.hpp"
+
+namespace {
+
+// Trees are built per block of this size, as the codec does
+constexpr size_t kBlockSize = 1 << 20;
+
+struct StageResult {
+  std::string stage;
+  double seconds = 0.0;
+  size_t peak_heap_bytes = 0;  // above the heap in use when the stage began
+};
+
+struct CorpusResult {
+  std::string name;
+  size_t size = 0;
+  size_t compressed_size = 0;
+  std::vector<StageResult> stages;
+};
+
+// Measure fn best-of, with setup run first inside the heap window so the
+// buffers and tables a stage allocates count towards its peak
+template <typename Setup, typename Fn>
+StageResult measure(const std::string& stage, const BenchOptions& options,
+                    Setup&& setup, Fn&& fn) {
+  StageResult result;
+  result.stage = stage;
+  size_t baseline = alloc_tracker::current_bytes();
+  alloc_tracker::reset_peak();
+  setup();
+  result.seconds = best_of(options.repetitions, fn);
+  result.peak_heap_bytes = alloc_tracker::peak_bytes() - baseline;
+  return result;
+}
+
+CorpusResult run_corpus(const std::string& name,
+                        const std::vector<uint8_t>& input,
+                        const BenchOptions& options) {
+  CorpusResult result;
+  result.name = name;
+  result.size = input.size();
+
+  // Histogram of the whole input
+  FrequencyAnalyzer::Histogram histogram{};
+  result.stages.push_back(measure(
+      "histogram", options, [] {},
+      [&] {
+        histogram.fill(0);
+        FrequencyAnalyzer::count(input.data(), input.size(), histogram);
+      }));
+
+  // One tree per block, from that block's histogram
+  std::vector<FrequencyAnalyzer::Histogram> block_histograms;
+  for (size_t offset = 0; offset < input.size(); offset += kBlockSize) {
+    block_histograms.emplace_back();
+    block_histograms.back().fill(0);
+    FrequencyAnalyzer::count(input.data() + offset,
+                             std::min(kBlockSize, input.size() - offset),
+                             block_histograms.back());
+  }
+  HuffmanTree tree;
+  result.stages.push_back(measure(
+      "tree", options, [] {},
+      [&] {
+        for (const auto& block_histogram : block_histograms) {
+          tree.build_tree(block_histogram);
+        }
+      }));
+
+  // Encode and decode loops under one table for the whole input
+  tree.build_tree(histogram);
+  CodeTable table = tree.code_table();
+  FastBitWriter writer;
+  result.stages.push_back(measure(
+      "encode", options, [&] { writer.clear(); },
+      [&] {
+        writer.clear();
+        for (uint8_t byte : input) {
+          const Code& code = table[byte];
+          writer.write_bits(code.bits, code.length);
+        }
+        writer.flush();
+      }));
+
+  HuffmanDecoder decoder;
+  std::vector<uint8_t> output;
+  result.stages.push_back(measure(
+      "decode", options,
+      [&] {
+        decoder.build(tree);
+        output.resize(input.size());
+      },
+      [&] {
+        FastBitReader reader(writer.data(), writer.byte_size());
+        decoder.decode(reader, output.data(), output.size());
+      }));
+  if (output != input) {
+    throw std::runtime_error("suite bench: " + name + " decode mismatch");
+  }
+  writer = FastBitWriter();
+  output = std::vector<uint8_t>();
+
+  // The whole codec: container, per-block tables, stored fallback
+  std::vector<uint8_t> packed;
+  std::vector<uint8_t> restored;
+  {
+    MemoryCodec codec;
+    result.stages.push_back(measure(
+        "compress", options, [] {},
+        [&] { codec.compress(input.data(), input.size(), packed); }));
+  }
+  {
+    MemoryCodec codec;
+    result.stages.push_back(measure(
+        "decompress", options, [] {},
+        [&] { codec.decompress(packed.data(), packed.size(), restored); }));
+  }
+  if (restored != input) {
+    throw std::runtime_error("suite bench: " + name + " round trip mismatch");
+  }
+  result.compressed_size = packed.size();
+  return result;
+}
+
+void print_corpus(const CorpusResult& corpus) {
+  std::cout << corpus.name << " (" << corpus.size << " bytes)  ratio "
+            << std::fixed << std::setprecision(3)
+            << static_cast<double>(corpus.compressed_size) / corpus.size
+            << "\n";
+  for (const auto& stage : corpus.stages) {
+    std::cout << "  " << std::left << std::setw(12) << stage.stage
+              << std::right << std::setw(10) << std::setprecision(1)
+              << megabytes_per_second(corpus.size, stage.seconds)
+              << " MB/s   peak heap " << std::setw(8)
+              << (stage.peak_heap_bytes + 1023) / 1024 << " KiB\n";
+  }
+}
+
+// One object per corpus, stage figures keyed by stage name
+void write_json(const std::string& file_name, const BenchOptions& options,
+                const std::vector<CorpusResult>& corpora) {
+  std::ostringstream json;
+  json << std::fixed << "{\n"
+       << "  \"benchmark\": \"suite\",\n"
+       << "  \"input_size\": " << options.input_size << ",\n"
+       << "  \"repetitions\": " << options.repetitions << ",\n"
+       << "  \"peak_rss_bytes\": " << alloc_tracker::peak_rss_bytes()
+       << ",\n"
+       << "  \"corpora\": [";
+  for (size_t c = 0; c < corpora.size(); ++c) {
+    const auto& corpus = corpora[c];
+    json << (c ? "," : "") << "\n    {\n"
+         << "      \"name\": \"" << corpus.name << "\",\n"
+         << "      \"size\": " << corpus.size << ",\n"
+         << "      \"compressed_size\": " << corpus.compressed_size << ",\n"
+         << "      \"ratio\": " << std::setprecision(4)
+         << static_cast<double>(corpus.compressed_size) / corpus.size
+         << ",\n"
+         << "      \"stages\": {";
+    for (size_t s = 0; s < corpus.stages.size(); ++s) {
+      const auto& stage = corpus.stages[s];
+      json << (s ? "," : "") << "\n        \"" << stage.stage << "\": {"
+           << "\"seconds\": " << std::setprecision(6) << stage.seconds
+           << ", \"mb_per_s\": " << std::setprecision(1)
+           << megabytes_per_second(corpus.size, stage.seconds)
+           << ", \"peak_heap_bytes\": " << stage.peak_heap_bytes << "}";
+    }
+    json << "\n      }\n    }";
+  }
+  json << "\n  ]\n}\n";
+
+  std::ofstream out(file_name);
+  out << json.str();
+  out.close();
+  if (!out) {
+    throw std::runtime_error("Failed to write " + file_name);
+  }
+  std::cout << "wrote " << file_name << "\n";
+}
+
+}  // namespace
+
+void run_suite_bench(const BenchOptions& options) {
+  // Generated one at a time so only one corpus is held at once
+  using Generator = std::vector<uint8_t> (*)(size_t size);
+  const std::pair<const char*, Generator> kCorpora[] = {
+      {"text", [](size_t size) { return make_text_corpus(size); }},
+      {"source", [](size_t size) { return make_source_corpus(size); }},
+      {"repetitive", [](size_t size) { return make_repetitive_corpus(size); }},
+      {"random", [](size_t size) { return make_random_corpus(size); }},
+      {"skewed", [](size_t size) { return make_skewed_corpus(size); }},
+      {"single", [](size_t size) { return std::vector<uint8_t>(size, 'a'); }},
+  };
+
+  std::vector<CorpusResult> results;
+  for (const auto& [name, generate] : kCorpora) {
+    results.push_back(run_corpus(name, generate(options.input_size), options));
+    print_corpus(results.back());
+  }
+  std::cout << "peak RSS: " << alloc_tracker::peak_rss_bytes() / (1024 * 1024)
+            << " MiB\n";
+
+  if (!options.json_file.empty()) {
+    write_json(options.json_file, options, results);
+  }
+}
@@ -0,0 +1,55 @@
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmarks.hpp"
+#include "core/huffman_tree.hpp"
+
+namespace {
+
+// Average microseconds per build over enough builds to be measurable
+template <typename Build>
+double microseconds_per_build(int repetitions, Build&& build) {
+  constexpr int kBuilds = 10000;
+  double seconds = best_of(repetitions, [&] {
+    for (int i = 0; i < kBuilds; ++i) {
+      build();
+    }
+  });
+  return seconds * 1e6 / kBuilds;
+}
+
+void run_alphabet(const std::string& name,
+                  const std::map<uint8_t, uint64_t>& frequencies,
+                  const BenchOptions& options) {
+  HuffmanTree tree;
+  double linear = microseconds_per_build(
+      options.repetitions, [&] { tree.build_tree(frequencies); });
+  double heap = microseconds_per_build(
+      options.repetitions, [&] { tree.build_tree_compatible(frequencies); });
+
+  for (const auto& result : {std::make_pair("two_queue", linear),
+                             std::make_pair("heap", heap)}) {
+    std::cout << std::left << std::setw(36)
+              << ("tree/" + name + "/" + result.first) << std::right
+              << std::setw(10) << std::fixed << std::setprecision(2)
+              << result.second << " us\n";
+  }
+}
+
+}  // namespace
+
+void run_tree_bench(const BenchOptions& options) {
+  run_alphabet("text",
+               count_frequencies(make_text_corpus(options.input_size)),
+               options);
+
+  std::vector<uint8_t> all_bytes(options.input_size);
+  for (size_t i = 0; i < all_bytes.size(); ++i) {
+    all_bytes[i] = static_cast<uint8_t>((i * 2654435761u) >> 13);
+  }
+  run_alphabet("256_symbols", count_frequencies(all_bytes), options);
+}
@@ -0,0 +1,113 @@
+#ifndef BATCH_ENCODER_HPP
+#define BATCH_ENCODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/block_codec.hpp"
+#include "core/codec_stats.hpp"
+#include "core/encoder.hpp"
+#include "core/progress_reporter.hpp"
+#include "core/shared_table.hpp"
+
+// Compresses or decompresses many files in one run, each output written
+// next to its input. Files go to a WorkStealingPool: a file of at least
+// kSplitBlocks blocks is coded block by block on every worker, and smaller
+// files are grouped into tasks of a few blocks' worth, so a single large
+// file and thousands of tiny ones both keep every worker busy. Blocks of
+// one file finish in any order and are written in order by whichever
+// worker completes the next one due; a worker starts a block at most
+// blocks_ahead() past the next one to write, so the coded blocks waiting
+// on a slow one stay few. The outputs are the same as Encoder's.
+class BatchEncoder {
+ public:
+  static constexpr size_t kSplitBlocks = 4;
+  static constexpr const char* kExtension = ".qcmp";
+
+  struct Result {
+    size_t files = 0;                   // outputs written
+    std::vector<std::string> failures;  // "<input>: <reason>", one per file
+    CodecStats stats;                   // summed over every file
+  };
+
+  explicit BatchEncoder(int num_threads = 1);
+  ~BatchEncoder();
+
+  BatchEncoder(const BatchEncoder&) = delete;
+  BatchEncoder& operator=(const BatchEncoder&) = delete;
+
+  void set_block_size(size_t bytes);
+  size_t block_size() const { return block_size_; }
+
+  int num_threads() const { return num_threads_; }
+  // Most blocks of one file coded beyond the next one to write
+  size_t blocks_ahead() const { return 2 * workers_.size() + 2; }
+
+  // As for Encoder
+  void set_max_code_length(int bits);
+  int max_code_length() const { return max_code_length_; }
+  void set_shared_table(std::shared_ptr<const SharedTable> table);
+  void set_context_mode(bool enabled);
+  bool context_mode() const { return context_mode_; }
+  void set_show_progress(bool enabled) { show_progress_ = enabled; }
+  void set_collect_stats(bool enabled) { collect_stats_ = enabled; }
+
+  // Replace outputs that already exist; otherwise such inputs fail and are
+  // reported with the others, their outputs left alone
+  void set_overwrite(bool enabled) { overwrite_ = enabled; }
+  bool overwrite() const { return overwrite_; }
+
+  // The named files and every regular file below the named directories;
+  // when decompressing, only the .qcmp files found in directories, and
+  // when compressing, none of them
+  static std::vector<std::string> collect_inputs(
+      const std::vector<std::string>& paths, bool compressing);
+
+  // <input>.qcmp, or for decompression the input without .qcmp (.out
+  // appended to names that lack it)
+  static std::string output_name(const std::string& input, bool compressing);
+
+  // A file that fails is reported in the result and its partial output
+  // removed; the others carry on
+  Result compress(const std::vector<std::string>& inputs);
+  Result decompress(const std::vector<std::string>& inputs);
+
+ private:
+  struct FileJob;
+
+  // State owned by one pool thread
+  struct Worker {
+    BlockCodec codec;
+    Encoder legacy;  // for decompressing legacy single-table files
+    CodecStats stats;
+  };
+
+  int num_threads_;
+  size_t block_size_ = Encoder::kDefaultBlockSize;
+  int max_code_length_ = 0;
+  bool context_mode_ = false;
+  bool overwrite_ = false;
+  bool show_progress_ = true;
+  bool collect_stats_ = false;
+  std::shared_ptr<const SharedTable> shared_table_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  Result run(const std::vector<std::string>& inputs, bool compressing);
+
+  // Map the input, open the output and cut the file into blocks; false
+  // when there is nothing left to code (empty or legacy files, failures)
+  bool open_job(FileJob& job, Worker& worker, ProgressReporter& progress);
+  // Claim the job's blocks in order and code them until none are left,
+  // writing whatever is due; whoever codes the last block finishes the file.
+  // A block more than blocks_ahead() past the next to write waits for it.
+  void code_blocks(FileJob& job, Worker& worker, ProgressReporter& progress);
+  // Write the coded blocks that are next in order; the job's mutex is held
+  void write_ready_blocks(FileJob& job, Worker& worker);
+  // End marker and index, then close; failed outputs are removed
+  void finish_job(FileJob& job, Worker& worker);
+};
+
+#endif
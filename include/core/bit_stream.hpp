@@ -1,6 +1,7 @@
 #ifndef BIT_STREAM_HPP
 #define BIT_STREAM_HPP
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -17,6 +18,10 @@ class BitStream {
   void write_bits(uint32_t value, int count);
   uint32_t read_bits(int count);
 
+  // look ahead without consuming; bits past the end read as zero
+  uint32_t peek_bits(int count) const;
+  void skip_bits(int count);
+
   // operations on bytes
   void writeByte(uint8_t byte);
   uint8_t readByte();
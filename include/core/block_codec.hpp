@@ -0,0 +1,112 @@
+#ifndef BLOCK_CODEC_HPP
+#define BLOCK_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/byte_sink.hpp"
+#include "core/canonical_code.hpp"
+#include "core/codec_stats.hpp"
+#include "core/container_format.hpp"
+#include "core/context_model.hpp"
+#include "core/fast_bit_stream.hpp"
+#include "core/frequency_analyzer.hpp"
+#include "core/huffman_decoder.hpp"
+#include "core/huffman_tree.hpp"
+#include "core/shared_table.hpp"
+
+// Encodes and decodes single container blocks entirely in memory. Each
+// instance keeps its own scratch state, so use one per thread.
+class BlockCodec {
+ public:
+  BlockCodec() = default;
+  ~BlockCodec() = default;
+
+  // Longest code the encoder may emit, 0 for unbounded Huffman codes. At
+  // HuffmanDecoder::kMaxPrimaryBits or below every symbol of a block with
+  // at least 2^bits symbols decodes with a single table lookup.
+  void set_max_code_length(int bits);
+  int max_code_length() const { return max_code_length_; }
+
+  // Code blocks with a pre-trained table unless their own table comes
+  // out smaller, and decode blocks that reference it. The table is not
+  // owned; nullptr returns to per-block tables.
+  void set_shared_table(const SharedTable* table) { shared_table_ = table; }
+
+  // Also try order-1 codes (one table per cluster of previous-byte
+  // contexts) and keep them for blocks where they come out smaller.
+  // Decoding needs no setting.
+  void set_context_mode(bool enabled) { context_mode_ = enabled; }
+  bool context_mode() const { return context_mode_; }
+
+  // Time the stages of every block into stats(); off by default
+  void set_collect_stats(bool enabled) { collect_stats_ = enabled; }
+  const CodecStats& stats() const { return stats_; }
+  void reset_stats() { stats_ = CodecStats(); }
+
+  // Append the block header and body for data to out, a vector or a
+  // caller's buffer
+  void encode_block(const uint8_t* data, size_t size, ByteSink out);
+
+  // Decode a block body into out, which holds header.original_size bytes
+  void decode_block(const BlockHeader& header, const uint8_t* body,
+                    uint8_t* out);
+
+ private:
+  // A shared-table block within 1/kSharedTableSlack of the smallest
+  // per-block code is taken without building the block's own tree
+  static constexpr size_t kSharedTableSlack = 32;
+
+  HuffmanTree huffman_tree_;
+  HuffmanDecoder huffman_decoder_;
+  CanonicalCode canonical_code_;
+  FastBitWriter bit_writer_;
+  int max_code_length_ = 0;
+  const SharedTable* shared_table_ = nullptr;
+  bool context_mode_ = false;
+  bool collect_stats_ = false;
+  CodecStats stats_;
+
+  // Order-1 state; the codes are sized kMaxClusters once used
+  ContextModel context_model_;
+  ContextModel::ContextMap context_map_{};
+  size_t num_context_codes_ = 0;
+  std::vector<CanonicalCode> context_codes_;
+  std::vector<CanonicalCode> trial_codes_;
+  std::vector<HuffmanDecoder> context_decoders_;
+  std::vector<FrequencyAnalyzer::Histogram> cluster_histograms_;
+
+  // Huffman code lengths for histogram within max_code_length_
+  CanonicalCode::Lengths code_lengths(
+      const FrequencyAnalyzer::Histogram& histogram);
+
+  void encode_shared_block(const uint8_t* data, size_t size,
+                           uint64_t encoded_bits, ByteSink out);
+  void encode_stored_block(const uint8_t* data, size_t size, ByteSink out);
+  // Cluster the counted contexts and keep the cheapest clustering in
+  // context_map_/context_codes_; returns the body size it needs
+  size_t plan_context_block(uint64_t& encoded_bits);
+  void encode_context_block(const uint8_t* data, size_t size,
+                            uint64_t encoded_bits, ByteSink out);
+  // Append the bit stream for data coded with table
+  void encode_bits(const uint8_t* data, size_t size, const CodeTable& table,
+                   uint64_t encoded_bits, ByteSink out);
+  // Jump table and one stream per run (see kHuffmanInterleaved)
+  void encode_interleaved(const uint8_t* data, size_t size,
+                          const CodeTable& table, uint64_t encoded_bits,
+                          ByteSink out);
+  // Fill in compressed_size once the body is complete
+  static void patch_body_size(ByteSink out, size_t header_offset,
+                              size_t body_offset);
+
+  // Frequency-table blocks as written before canonical codes
+  void decode_frequency_block(const BlockHeader& header, const uint8_t* body,
+                              uint8_t* out);
+  void decode_context_block(const BlockHeader& header, const uint8_t* body,
+                            uint8_t* out);
+  void decode_interleaved_block(const BlockHeader& header,
+                                const uint8_t* body, uint8_t* out);
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef BLOCK_PIPELINE_HPP
+#define BLOCK_PIPELINE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "core/container_format.hpp"
+#include "core/input_source.hpp"
+
+// Reader -> coders -> writer over a fixed set of reusable block slots, so
+// reading, coding and writing overlap instead of taking turns. The reader
+// runs on its own thread, each coder on another, and the writer on the
+// calling thread, which gets the slots back in input order. Once every
+// slot is in flight the reader waits, which bounds memory.
+class BlockPipeline {
+ public:
+  struct Slot {
+    uint64_t sequence = 0;       // position in the input, from 0
+    InputSource::Span span;      // block to compress
+    BlockHeader header;          // block to decompress
+    std::vector<uint8_t> input;  // bytes read into this slot, if any
+    std::vector<uint8_t> output;
+  };
+
+  // Fill the slot with the next block; false at the end of the input
+  using ReadFn = std::function<bool(Slot& slot)>;
+  // Code the slot on coder number coder (0 .. num_coders - 1)
+  using CodeFn = std::function<void(Slot& slot, size_t coder)>;
+  // Consume a coded slot; called in input order
+  using WriteFn = std::function<void(Slot& slot)>;
+
+  // num_slots of 0 picks two per coder plus one each for reader and writer
+  explicit BlockPipeline(size_t num_coders, size_t num_slots = 0);
+  ~BlockPipeline() = default;
+
+  size_t num_coders() const { return num_coders_; }
+
+  // Runs until read() reports the end and every block is written. The
+  // first exception from any stage stops the others and is rethrown.
+  void run(const ReadFn& read, const CodeFn& code, const WriteFn& write);
+
+ private:
+  size_t num_coders_;
+  std::vector<Slot> slots_;  // buffers are kept between runs
+};
+
+#endif
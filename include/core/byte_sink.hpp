@@ -0,0 +1,64 @@
+#ifndef BYTE_SINK_HPP
+#define BYTE_SINK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// A caller-owned buffer of fixed capacity, filled from the front
+struct BoundedBuffer {
+  uint8_t* data = nullptr;
+  size_t capacity = 0;
+  size_t size = 0;  // bytes written so far
+};
+
+// Where encoded bytes are appended: a vector, which grows as needed, or a
+// BoundedBuffer, which throws rather than overflow. A handle to either,
+// cheap to pass by value; the bytes and their count live behind it.
+class ByteSink {
+ public:
+  // Implicit, so callers holding a vector pass it as it is
+  ByteSink(std::vector<uint8_t>& out) : vector_(&out) {}
+  ByteSink(BoundedBuffer& out) : bounded_(&out) {}
+
+  size_t size() const { return vector_ ? vector_->size() : bounded_->size; }
+  uint8_t* data() { return vector_ ? vector_->data() : bounded_->data; }
+
+  void push_back(uint8_t byte) {
+    if (vector_) {
+      vector_->push_back(byte);
+    } else {
+      *grow(1) = byte;
+    }
+  }
+
+  void append(const uint8_t* bytes, size_t count) {
+    if (vector_) {
+      vector_->insert(vector_->end(), bytes, bytes + count);
+    } else if (count > 0) {
+      std::memcpy(grow(count), bytes, count);
+    }
+  }
+
+  // Add count bytes at the end for the caller to fill in
+  uint8_t* grow(size_t count) {
+    size_t offset = size();
+    if (vector_) {
+      vector_->resize(offset + count);
+      return vector_->data() + offset;
+    }
+    if (count > bounded_->capacity - offset) {
+      throw std::runtime_error("ByteSink: Output buffer too small");
+    }
+    bounded_->size += count;
+    return bounded_->data + offset;
+  }
+
+ private:
+  std::vector<uint8_t>* vector_ = nullptr;
+  BoundedBuffer* bounded_ = nullptr;
+};
+
+#endif
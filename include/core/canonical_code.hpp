@@ -0,0 +1,56 @@
+#ifndef CANONICAL_CODE_HPP
+#define CANONICAL_CODE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/byte_sink.hpp"
+#include "core/code_table.hpp"
+
+// Canonical Huffman code: codes are assigned in (length, symbol) order, so
+// the code lengths alone describe the whole code. This is what block
+// headers store instead of the frequency table.
+class CanonicalCode {
+ public:
+  static constexpr int kMaxCodeLength = 64;
+  // Largest serialize() output: 256 lengths packed at 7 bits each
+  static constexpr size_t kMaxSerializedSize = 2 + 256 * 7 / 8;
+
+  using Lengths = std::array<uint8_t, 256>;  // 0 for absent symbols
+
+  CanonicalCode() = default;
+  ~CanonicalCode() = default;
+
+  // Assign canonical codes; throws if the lengths cannot form a prefix code
+  void assign(const Lengths& lengths);
+
+  const Lengths& lengths() const { return lengths_; }
+  uint8_t length(uint8_t symbol) const { return lengths_[symbol]; }
+  uint64_t code(uint8_t symbol) const { return table_[symbol].bits; }
+  // Codes and lengths side by side for the encode loop
+  const CodeTable& table() const { return table_; }
+  int max_length() const { return max_length_; }
+
+  // Compact length table: a list of (symbol, length) pairs or all 256
+  // lengths bit-packed, whichever is smaller
+  void serialize(ByteSink out) const;
+  size_t serialized_size() const;
+  // Smallest table any code over num_symbols symbols can serialize to
+  static size_t min_serialized_size(size_t num_symbols);
+  // Returns the number of bytes consumed from in
+  size_t deserialize(const uint8_t* in, size_t size);
+
+ private:
+  enum class TableFormat : uint8_t { kSparse = 0, kPacked = 1 };
+
+  // Bits per length in the packed form
+  static int packed_width(int max_length);
+
+  Lengths lengths_{};
+  CodeTable table_{};
+  int max_length_ = 0;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef CODE_TABLE_HPP
+#define CODE_TABLE_HPP
+
+#include <array>
+#include <cstdint>
+
+// One symbol's prefix code, right-aligned: the first bit of the code is
+// bit (length - 1) of bits, matching FastBitWriter::write_bits
+struct Code {
+  uint64_t bits = 0;
+  uint8_t length = 0;  // 0 for symbols without a code
+};
+
+// Codes for every byte value, indexed by the byte itself
+using CodeTable = std::array<Code, 256>;
+
+#endif
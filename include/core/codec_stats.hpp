@@ -0,0 +1,89 @@
+#ifndef CODEC_STATS_HPP
+#define CODEC_STATS_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Where one compress or decompress call spent its time. Stages are timed
+// per block, a couple of clock reads each, so collecting costs nothing
+// measurable. Stages run concurrently, so their times add up to more than
+// the wall time: the pipeline has one reader, threads coders and one
+// writer, while the indexed decoder and batch mode read and write on every
+// thread. A stage busy for nearly all of the wall time, per thread it runs
+// on, is the bottleneck.
+struct CodecStats {
+  enum Stage : size_t {
+    kRead,       // waiting for input
+    kHistogram,  // counting symbols (and contexts)
+    kTree,       // code lengths, context clustering
+    kEncode,     // emitting bits, or copying stored blocks
+    kDecode,     // decoding blocks, table builds included
+    kWrite,      // handing output to the stream
+    kNumStages
+  };
+
+  struct StageTotal {
+    double seconds = 0.0;
+    uint64_t bytes = 0;
+  };
+
+  bool compressing = true;
+  int threads = 1;     // threads that code blocks
+  int io_threads = 1;  // threads that read and write, each its own blocks
+  uint64_t original_bytes = 0;
+  uint64_t compressed_bytes = 0;
+  uint64_t blocks = 0;
+  double wall_seconds = 0.0;
+  std::array<StageTotal, kNumStages> stages{};
+
+  static const char* stage_name(Stage stage);
+
+  // Sum another thread's stage times and block count into this one
+  void add_stages(const CodecStats& other);
+
+  double ratio() const;
+  // Compressed bits per original byte
+  double bits_per_symbol() const;
+
+  void print_text(std::ostream& out) const;
+  // One JSON object, stage figures keyed by stage name
+  void print_json(std::ostream& out) const;
+};
+
+// Adds the time since the previous lap (or construction) to a stage.
+// With no stats it does nothing, not even read the clock.
+class StageClock {
+ public:
+  explicit StageClock(CodecStats* stats) : stats_(stats) {
+    if (stats_) {
+      last_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  void lap(CodecStats::Stage stage, uint64_t bytes) {
+    if (!stats_) {
+      return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    stats_->stages[stage].seconds +=
+        std::chrono::duration<double>(now - last_).count();
+    stats_->stages[stage].bytes += bytes;
+    last_ = now;
+  }
+
+  // Start the next lap from now, leaving out the time in between
+  void restart() {
+    if (stats_) {
+      last_ = std::chrono::steady_clock::now();
+    }
+  }
+
+ private:
+  CodecStats* stats_;
+  std::chrono::steady_clock::time_point last_;
+};
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef CONTAINER_FORMAT_HPP
+#define CONTAINER_FORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/byte_sink.hpp"
+
+// Block container layout (.qcmp), all integers little-endian:
+//
+//   File header:  magic "QCMP" (4) | version (1) | flags (1) |
+//                 reserved (2) | block size (4)
+//   Blocks:       block header | block body, repeated in input order
+//   End marker:   block header with original size 0
+//   Block index:  entry count (4) | entries, present with kFlagBlockIndex
+//   Trailer:      index offset (8) | magic "QIDX"
+//
+// The index lets a reader locate every block and its output position
+// without decoding its predecessors. Every block but the last holds
+// exactly block size original bytes, so original offset x lies in block
+// x / block size, whose entry sits at a fixed place in the index: a byte
+// range is read through the trailer, its entries and its blocks alone.
+//
+// Files without the magic are the legacy single-table format, whose
+// first field is a symbol count of at most 256.
+
+constexpr uint8_t kContainerMagic[4] = {'Q', 'C', 'M', 'P'};
+constexpr uint8_t kContainerVersion = 1;
+constexpr size_t kFileHeaderSize = 12;
+
+constexpr size_t kMaxBlockSize = size_t{1} << 30;
+
+constexpr uint8_t kFlagBlockIndex = 0x01;
+constexpr uint8_t kIndexMagic[4] = {'Q', 'I', 'D', 'X'};
+constexpr size_t kIndexTrailerSize = 12;
+
+struct FileHeader {
+  uint8_t version = kContainerVersion;
+  uint8_t flags = 0;
+  uint32_t block_size = 0;  // nominal original bytes per block
+};
+
+enum class BlockType : uint8_t {
+  kHuffman = 0,             // frequency table followed by the bit stream
+  kHuffmanCanonical = 1,    // canonical code lengths followed by the stream
+  kHuffmanShared = 2,       // shared table ID (4) followed by the stream
+  kStored = 3,              // the original bytes, for blocks that do not shrink
+  kHuffmanContext = 4,      // order-1 tables (see ContextModel) and the stream
+  kHuffmanInterleaved = 5,  // code lengths, jump table, interleaved streams
+};
+
+// Interleaved blocks split their bytes into kInterleavedStreams runs of
+// original_size / kInterleavedStreams bytes, the last run taking the
+// remainder. Each run is its own byte-aligned stream under the shared
+// code, and the jump table holds the sizes of all streams but the last
+// (4 bytes each), so a decoder can advance them together.
+constexpr size_t kInterleavedStreams = 4;
+constexpr size_t kJumpTableSize = 4 * (kInterleavedStreams - 1);
+// Smaller blocks keep a single stream; the jump table would cost more
+// than the decoder gains
+constexpr size_t kMinInterleavedBlockSize = 16 * 1024;
+
+// No Huffman code costs more than the flat 8-bit one, so a block body
+// never exceeds its original bytes by more than the largest table (the
+// frequency table of kHuffman blocks), a jump table and a padding byte
+// per stream
+constexpr size_t kMaxBlockOverhead =
+    2 + 256 * 5 + kJumpTableSize + kInterleavedStreams;
+
+struct BlockHeader {
+  static constexpr size_t kSize = 9;
+
+  uint32_t original_size = 0;    // decoded bytes, 0 marks the end
+  uint32_t compressed_size = 0;  // body bytes following this header
+  BlockType type = BlockType::kHuffman;
+};
+
+struct BlockIndexEntry {
+  static constexpr size_t kSize = 16;
+
+  uint64_t offset = 0;         // file offset of the block header
+  uint32_t stored_size = 0;    // block header plus body bytes
+  uint32_t original_size = 0;  // decoded bytes
+};
+
+inline void append_u16(ByteSink out, uint16_t value) {
+  out.push_back(static_cast<uint8_t>(value));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+inline void append_u32(ByteSink out, uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    out.push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+inline void append_u64(ByteSink out, uint64_t value) {
+  for (int shift = 0; shift < 64; shift += 8) {
+    out.push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+inline void store_u32(uint8_t* out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+inline uint16_t load_u16(const uint8_t* in) {
+  return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+inline uint32_t load_u32(const uint8_t* in) {
+  return uint32_t{in[0]} | (uint32_t{in[1]} << 8) | (uint32_t{in[2]} << 16) |
+         (uint32_t{in[3]} << 24);
+}
+
+inline uint64_t load_u64(const uint8_t* in) {
+  return uint64_t{load_u32(in)} | (uint64_t{load_u32(in + 4)} << 32);
+}
+
+inline void append_file_header(ByteSink out, const FileHeader& header) {
+  out.append(kContainerMagic, 4);
+  out.push_back(header.version);
+  out.push_back(header.flags);
+  append_u16(out, 0);
+  append_u32(out, header.block_size);
+}
+
+// in points at the byte after the magic
+inline FileHeader load_file_header(const uint8_t* in) {
+  FileHeader header;
+  header.version = in[0];
+  header.flags = in[1];
+  header.block_size = load_u32(in + 4);
+  return header;
+}
+
+inline bool has_container_magic(const uint8_t* in) {
+  return in[0] == kContainerMagic[0] && in[1] == kContainerMagic[1] &&
+         in[2] == kContainerMagic[2] && in[3] == kContainerMagic[3];
+}
+
+inline void append_block_header(ByteSink out, const BlockHeader& header) {
+  append_u32(out, header.original_size);
+  append_u32(out, header.compressed_size);
+  out.push_back(static_cast<uint8_t>(header.type));
+}
+
+inline BlockHeader load_block_header(const uint8_t* in) {
+  BlockHeader header;
+  header.original_size = load_u32(in);
+  header.compressed_size = load_u32(in + 4);
+  header.type = static_cast<BlockType>(in[8]);
+  return header;
+}
+
+// Index entries followed by the trailer pointing back at them
+inline void append_block_index(ByteSink out,
+                               const std::vector<BlockIndexEntry>& entries,
+                               uint64_t index_offset) {
+  append_u32(out, static_cast<uint32_t>(entries.size()));
+  for (const auto& entry : entries) {
+    append_u64(out, entry.offset);
+    append_u32(out, entry.stored_size);
+    append_u32(out, entry.original_size);
+  }
+  append_u64(out, index_offset);
+  out.append(kIndexMagic, 4);
+}
+
+// File offset of entry number block of the index at index_offset
+inline uint64_t block_index_entry_offset(uint64_t index_offset,
+                                         uint64_t block) {
+  return index_offset + 4 + block * BlockIndexEntry::kSize;
+}
+
+inline BlockIndexEntry load_block_index_entry(const uint8_t* in) {
+  BlockIndexEntry entry;
+  entry.offset = load_u64(in);
+  entry.stored_size = load_u32(in + 8);
+  entry.original_size = load_u32(in + 12);
+  return entry;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef CONTEXT_MODEL_HPP
+#define CONTEXT_MODEL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/byte_sink.hpp"
+#include "core/frequency_analyzer.hpp"
+
+// Order-1 statistics: one histogram per previous byte. A code per context
+// would cost 256 length tables per block, so contexts with similar
+// statistics are clustered and share a table; the context map names each
+// context's cluster.
+//
+// Serialized map: 256 cluster numbers, 4 bits each, high nibble first
+class ContextModel {
+ public:
+  static constexpr size_t kMaxClusters = 16;
+  static constexpr size_t kSerializedMapSize = 128;
+
+  using Histogram = FrequencyAnalyzer::Histogram;
+  using ContextMap = std::array<uint8_t, 256>;  // context -> cluster
+
+  ContextModel() = default;
+  ~ContextModel() = default;
+
+  // Replace the counts with those of data; the first byte's context is 0
+  void count(const uint8_t* data, size_t size);
+
+  const Histogram& histogram(uint8_t context) const {
+    return histograms_[context];
+  }
+  // Plain byte counts, summed over all contexts
+  Histogram order0() const;
+  // Entropy of each byte given the previous one, in bits; no order-1
+  // code can be smaller
+  double conditional_entropy_bits() const;
+
+  // Group the contexts into at most max_clusters clusters that cost few
+  // bits when coded together. Fills map and the per-cluster histograms and
+  // returns the number of clusters used.
+  size_t cluster(size_t max_clusters, ContextMap& map,
+                 std::vector<Histogram>& clusters) const;
+
+  static void serialize_map(const ContextMap& map, ByteSink out);
+  // Reads kSerializedMapSize bytes; throws if a context names a cluster
+  // at or above num_clusters
+  static void deserialize_map(const uint8_t* in, size_t num_clusters,
+                              ContextMap& map);
+
+ private:
+  std::vector<Histogram> histograms_;  // 256 once counted
+};
+
+#endif
@@ -1,34 +1,136 @@
 #ifndef ENCODER_HPP
 #define ENCODER_HPP
 
+#include <chrono>
 #include <cstdint>
 #include <fstream>
+#include <istream>
 #include <map>
+#include <memory>
+#include <ostream>
 #include <string>
 #include <vector>
 
-#include "core/bit_stream.hpp"
-#include "core/frequency_analyzer.hpp"
+#include "core/block_codec.hpp"
+#include "core/block_pipeline.hpp"
+#include "core/codec_stats.hpp"
+#include "core/container_format.hpp"
+#include "core/huffman_decoder.hpp"
 #include "core/huffman_tree.hpp"
+#include "core/progress_reporter.hpp"
+#include "core/shared_table.hpp"
 
 class Encoder {
  public:
+  // Legacy files are decoded through buffers of this size
+  static constexpr size_t kDefaultBufferSize = 1 << 20;
+  // Input is split into independently coded blocks of this size
+  static constexpr size_t kDefaultBlockSize = 1 << 20;
+
   Encoder() = default;
   ~Encoder() = default;
 
+  // Either file may be "-" for standard input/output. Both directions read
+  // their input once, front to back, so they work in pipelines.
   void compress(const std::string& input_file, const std::string& output_file);
   void decompress(const std::string& input_file,
                   const std::string& output_file);
 
+  // Decompress only original bytes [offset, offset + length), cut short
+  // at the end of the data, and return how many were written. Reads just
+  // the index entries and blocks covering the range, so the cost does not
+  // grow with the file. The input must be a container file; the output
+  // may be "-".
+  uint64_t decompress_range(const std::string& input_file,
+                            const std::string& output_file, uint64_t offset,
+                            uint64_t length);
+
+  // Chunk size for decoding pre-container files; containers are read a
+  // block at a time
+  void set_buffer_size(size_t bytes);
+  size_t buffer_size() const { return buffer_size_; }
+
+  void set_block_size(size_t bytes);
+  size_t block_size() const { return block_size_; }
+
+  // Blocks are coded on this many threads
+  void set_num_threads(int num_threads);
+  int num_threads() const { return num_threads_; }
+
+  // Cap on Huffman code lengths, 0 for unbounded (see BlockCodec)
+  void set_max_code_length(int bits);
+  int max_code_length() const { return max_code_length_; }
+
+  // Pre-trained table for compression, and for decompressing files that
+  // were written with it; nullptr for per-block tables
+  void set_shared_table(std::shared_ptr<const SharedTable> table);
+
+  // Let blocks use order-1 context tables when smaller (see BlockCodec)
+  void set_context_mode(bool enabled) { context_mode_ = enabled; }
+  bool context_mode() const { return context_mode_; }
+
+  // Progress bar on standard error, drawn only when it is a terminal
+  void set_show_progress(bool enabled) { show_progress_ = enabled; }
+  bool show_progress() const { return show_progress_; }
+
+  // Time every stage of each call; stats() then describes the last one
+  void set_collect_stats(bool enabled) { collect_stats_ = enabled; }
+  const CodecStats& stats() const { return stats_; }
+
  private:
-  FrequencyAnalyzer frequency_analyzer_;
+  size_t buffer_size_ = kDefaultBufferSize;
+  size_t block_size_ = kDefaultBlockSize;
+  int num_threads_ = 1;
+  int max_code_length_ = 0;
+  bool context_mode_ = false;
+  bool collect_stats_ = false;
+  bool show_progress_ = true;
+  std::shared_ptr<const SharedTable> shared_table_;
+  CodecStats stats_;
+  std::chrono::steady_clock::time_point stats_start_;
+
   HuffmanTree huffman_tree_;
-  BitStream bit_stream_;
+  HuffmanDecoder huffman_decoder_;
+  // One codec per concurrently coded block
+  std::vector<std::unique_ptr<BlockCodec>> block_codecs_;
+  // Read/code/write stages; its slots keep their buffers between files
+  std::unique_ptr<BlockPipeline> pipeline_;
+
+  void ensure_block_codecs(size_t count);
+  bool progress_enabled() const {
+    return show_progress_ && ProgressReporter::stderr_is_terminal();
+  }
+  // Stage times go to stats_ only when collecting
+  CodecStats* stage_stats() { return collect_stats_ ? &stats_ : nullptr; }
+  void start_stats(bool compressing);
+  // Fold in the codecs' stage times and the wall time since start_stats
+  void finish_stats();
+  BlockPipeline& ensure_pipeline(size_t num_coders);
 
-  void write_header(std::ofstream& output,
-                    const std::map<uint8_t, uint64_t>& frequencies);
+  // file_size is 0 when the input is a stream of unknown length
+  void decompress_blocks(std::istream& input, std::ostream& output,
+                         const FileHeader& header, size_t file_size);
+  void decompress_indexed(const std::string& input_file,
+                          const std::string& output_file,
+                          const std::vector<BlockIndexEntry>& block_index,
+                          size_t file_size);
+  // The symbol count, the first field, has already been read
+  void decompress_legacy(std::istream& input, std::ostream& output,
+                         uint32_t num_unique_chars);
 
-  std::map<uint8_t, uint64_t> read_header(std::ifstream& input);
+  std::map<uint8_t, uint64_t> read_header(std::istream& input,
+                                          uint32_t num_unique_chars);
+  std::vector<BlockIndexEntry> read_block_index(std::ifstream& input,
+                                                size_t file_size,
+                                                const FileHeader& header);
+  // Offset of the index named by the trailer; sets its entry count
+  uint64_t locate_block_index(std::ifstream& input, size_t file_size,
+                              uint32_t& num_blocks);
+  // count entries from number first on, read in one piece
+  std::vector<BlockIndexEntry> read_index_entries(std::ifstream& input,
+                                                  uint64_t index_offset,
+                                                  uint64_t first, size_t count,
+                                                  const FileHeader& header);
 };
 
 #endif
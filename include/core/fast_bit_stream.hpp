@@ -0,0 +1,206 @@
+#ifndef FAST_BIT_STREAM_HPP
+#define FAST_BIT_STREAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+// Word-at-a-time counterparts of BitStream. Both keep a 64-bit accumulator
+// and use the same MSB-first bit order, so their bytes are interchangeable
+// with BitStream::get_buffer()/load_from_buffer().
+
+class FastBitWriter {
+ public:
+  FastBitWriter() = default;
+  ~FastBitWriter() = default;
+
+  // Append the low count bits of value, most significant first
+  void write_bits(uint64_t value, int count) {
+    if (count < 0 || count > 64) {
+      throw std::invalid_argument(
+          "FastBitWriter: Count must be between 0 and 64");
+    }
+    if (count > 32) {
+      // Only codes from very deep trees get here
+      write_bits(value >> 32, count - 32);
+      write_bits(value & 0xFFFFFFFF, 32);
+      return;
+    }
+
+    accumulator_ = (accumulator_ << count) |
+                   (value & ((uint64_t{1} << count) - 1));
+    pending_bits_ += count;
+    if (pending_bits_ >= 32) {
+      flush_word();
+    }
+  }
+
+  void write_bit(bool bit) { write_bits(bit ? 1 : 0, 1); }
+
+  // Pre-size the buffer for at least bytes of output
+  void reserve(size_t bytes) {
+    if (buffer_.size() < bytes + kSlackBytes) {
+      buffer_.resize(bytes + kSlackBytes);
+    }
+  }
+
+  // Pad the last partial byte with zero bits
+  void flush() {
+    while (pending_bits_ >= 8) {
+      pending_bits_ -= 8;
+      append_byte(static_cast<uint8_t>(accumulator_ >> pending_bits_));
+    }
+    if (pending_bits_ > 0) {
+      append_byte(static_cast<uint8_t>(accumulator_ << (8 - pending_bits_)));
+      pending_bits_ = 0;
+    }
+    accumulator_ = 0;
+  }
+
+  // Forget written bytes but keep the allocated capacity
+  void clear() {
+    byte_count_ = 0;
+    drained_bytes_ = 0;
+    accumulator_ = 0;
+    pending_bits_ = 0;
+  }
+
+  // Write the complete bytes to output; pending bits stay buffered
+  void drain_to(std::ostream& output) {
+    output.write(reinterpret_cast<const char*>(buffer_.data()), byte_count_);
+    drained_bytes_ += byte_count_;
+    byte_count_ = 0;
+  }
+
+  const uint8_t* data() const { return buffer_.data(); }
+  size_t byte_size() const { return byte_count_; }  // complete bytes only
+  uint64_t drained_bytes() const { return drained_bytes_; }
+  uint64_t bit_size() const {
+    return (drained_bytes_ + byte_count_) * 8 + pending_bits_;
+  }
+
+ private:
+  static constexpr size_t kSlackBytes = 8;
+
+  std::vector<uint8_t> buffer_;
+  size_t byte_count_ = 0;
+  uint64_t drained_bytes_ = 0;
+  uint64_t accumulator_ = 0;  // low pending_bits_ bits are not yet written
+  int pending_bits_ = 0;
+
+  void flush_word() {
+    if (buffer_.size() < byte_count_ + kSlackBytes) {
+      buffer_.resize(buffer_.size() * 2 + 4096);
+    }
+
+    pending_bits_ -= 32;
+    uint32_t word = static_cast<uint32_t>(accumulator_ >> pending_bits_);
+    uint8_t* out = buffer_.data() + byte_count_;
+    out[0] = static_cast<uint8_t>(word >> 24);
+    out[1] = static_cast<uint8_t>(word >> 16);
+    out[2] = static_cast<uint8_t>(word >> 8);
+    out[3] = static_cast<uint8_t>(word);
+    byte_count_ += 4;
+  }
+
+  void append_byte(uint8_t byte) {
+    if (buffer_.size() < byte_count_ + kSlackBytes) {
+      buffer_.resize(buffer_.size() * 2 + 4096);
+    }
+    buffer_[byte_count_++] = byte;
+  }
+};
+
+class FastBitReader {
+ public:
+  // Maximum bits peek_bits() can return after refill()
+  static constexpr int kMaxPeekBits = 56;
+
+  FastBitReader() = default;
+  FastBitReader(const uint8_t* data, size_t size) { reset(data, size); }
+  ~FastBitReader() = default;
+
+  // Start reading a new buffer; the reader does not copy it
+  void reset(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    position_ = 0;
+    accumulator_ = 0;
+    available_bits_ = 0;
+  }
+
+  // Continue from a new buffer whose first byte is the first unread byte of
+  // the old one; bits already in the accumulator are kept
+  void rebase(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    position_ = 0;
+  }
+
+  // Top up the accumulator to at least kMaxPeekBits while input remains
+  void refill() {
+    if (position_ + 8 <= size_) {
+      const uint8_t* p = data_ + position_;
+      uint64_t word = (uint64_t{p[0]} << 56) | (uint64_t{p[1]} << 48) |
+                      (uint64_t{p[2]} << 40) | (uint64_t{p[3]} << 32) |
+                      (uint64_t{p[4]} << 24) | (uint64_t{p[5]} << 16) |
+                      (uint64_t{p[6]} << 8) | uint64_t{p[7]};
+      accumulator_ |= word >> available_bits_;
+      position_ += (63 - available_bits_) >> 3;
+      available_bits_ |= kMaxPeekBits;
+      return;
+    }
+
+    while (available_bits_ <= kMaxPeekBits && position_ < size_) {
+      accumulator_ |= uint64_t{data_[position_++]}
+                      << (kMaxPeekBits - available_bits_);
+      available_bits_ += 8;
+    }
+  }
+
+  // Next count bits without consuming; missing bits past the end read as 0
+  uint32_t peek_bits(int count) const {
+    return count == 0 ? 0
+                      : static_cast<uint32_t>(accumulator_ >> (64 - count));
+  }
+
+  void consume_bits(int count) {
+    if (count > available_bits_) {
+      throw std::runtime_error("FastBitReader: End of stream reached");
+    }
+    accumulator_ <<= count;
+    available_bits_ -= count;
+  }
+
+  uint32_t read_bits(int count) {
+    if (count < 0 || count > 32) {
+      throw std::invalid_argument(
+          "FastBitReader: Count must be between 0 and 32");
+    }
+    refill();
+    uint32_t value = peek_bits(count);
+    consume_bits(count);
+    return value;
+  }
+
+  bool read_bit() { return read_bits(1) != 0; }
+
+  int available_bits() const { return available_bits_; }
+  size_t unread_bytes() const { return size_ - position_; }
+
+  // Bits not yet consumed, including those still in the buffer
+  uint64_t bits_remaining() const {
+    return (size_ - position_) * 8 + available_bits_;
+  }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  size_t position_ = 0;
+  uint64_t accumulator_ = 0;  // unread bits, left-aligned
+  int available_bits_ = 0;
+};
+
+#endif
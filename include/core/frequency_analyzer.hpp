@@ -1,16 +1,42 @@
 #ifndef FREQUENCY_ANALYZER_HPP
 #define FREQUENCY_ANALYZER_HPP
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <map>
 #include <string>
 
+class InputSource;
+
 class FrequencyAnalyzer {
  public:
+  // Occurrences of every byte value, indexed by the byte
+  using Histogram = std::array<uint64_t, 256>;
+
   FrequencyAnalyzer() = default;
   ~FrequencyAnalyzer() = default;
 
   std::map<uint8_t, uint64_t> analyze_file(const std::string& file_name) const;
+  // Counts the whole source and rewinds it for the encoding pass
+  std::map<uint8_t, uint64_t> analyze_source(InputSource& source) const;
+  std::map<uint8_t, uint64_t> analyze_buffer(const uint8_t* data,
+                                             size_t size) const;
+
+  // Counting kernels; count() adds to histogram rather than resetting it
+  static void count(const uint8_t* data, size_t size, Histogram& histogram);
+  static Histogram count_parallel(const uint8_t* data, size_t size,
+                                  int num_threads);
+
+  // Nonzero entries only, the form HuffmanTree::build_tree expects
+  static std::map<uint8_t, uint64_t> to_map(const Histogram& histogram);
+
+  // Shannon entropy of the whole histogram in bits, a lower bound on the
+  // size of any prefix code for it
+  static double entropy_bits(const Histogram& histogram);
+
+ private:
+  static constexpr size_t kChunkSize = 1 << 16;
 };
 
 #endif
@@ -0,0 +1,102 @@
+#ifndef HUFFMAN_DECODER_HPP
+#define HUFFMAN_DECODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Forward declarations
+class BitStream;
+class CanonicalCode;
+class FastBitReader;
+class HuffmanTree;
+
+// Table-driven Huffman decoder. The primary table is indexed by the next
+// bits of the stream: as many as the longest code when that is at most
+// kMaxPrimaryBits, so every symbol takes one lookup, and kPrimaryBits
+// otherwise, with longer codes chaining into sub-tables, so any code
+// length produced by HuffmanTree can be decoded.
+class HuffmanDecoder {
+ public:
+  static constexpr int kPrimaryBits = 11;
+  // 2^15 entries of 8 bytes, 256 KiB: still cheap to fill once per block
+  // and mostly cache-resident, since long codes are the rare symbols
+  static constexpr int kMaxPrimaryBits = 15;
+  static constexpr int kMaxSubTableBits = 8;
+
+  HuffmanDecoder() = default;
+  ~HuffmanDecoder() = default;
+
+  void build(const HuffmanTree& tree);
+  // Build straight from canonical code lengths, no tree needed. symbols is
+  // about how many symbols the table will decode: the primary table only
+  // widens past kPrimaryBits while filling it costs less than that.
+  void build(const CanonicalCode& code, size_t symbols = SIZE_MAX);
+  bool empty() const { return table_.empty(); }
+  int max_code_length() const { return max_code_length_; }
+  // True when every code resolves in the primary table (complete codes no
+  // longer than kMaxPrimaryBits, e.g. from a length-limited encoder)
+  bool single_lookup() const { return single_lookup_; }
+
+  // Decode a single symbol from the bit stream
+  uint8_t decode_symbol(BitStream& bit_stream) const;
+
+  // Decode count symbols from the bit stream into out
+  void decode(BitStream& bit_stream, uint8_t* out, size_t count) const;
+
+  // Same as above, reading through a word-at-a-time accumulator
+  uint8_t decode_symbol(FastBitReader& reader) const;
+  void decode(FastBitReader& reader, uint8_t* out, size_t count) const;
+
+  // Decode count symbols from each of four independent streams coded
+  // with this table into the matching outputs. The lookups of the four
+  // streams do not depend on each other, so they overlap in the CPU.
+  void decode_interleaved(FastBitReader* readers, uint8_t* const* outs,
+                          size_t count) const;
+
+  // Order-1 decoding: each symbol is decoded with decoders[previous byte],
+  // starting from context 0. All 256 entries must point at built decoders.
+  static void decode_order1(const HuffmanDecoder* const* decoders,
+                            FastBitReader& reader, uint8_t* out,
+                            size_t count);
+
+ private:
+  enum class EntryKind : uint8_t { kInvalid, kLeaf, kLink };
+
+  struct Entry {
+    uint32_t value = 0;  // symbol for leaves, sub-table offset for links
+    uint8_t length = 0;  // code bits for leaves, sub-table width for links
+    EntryKind kind = EntryKind::kInvalid;
+  };
+
+  struct CodeEntry {
+    uint64_t code;
+    uint8_t length;
+    uint8_t symbol;
+  };
+
+  std::vector<Entry> table_;
+  std::vector<CodeEntry> codes_;  // build scratch, kept between builds
+  int primary_bits_ = 0;
+  int max_code_length_ = 0;
+  bool single_lookup_ = false;
+
+  // Primary table width for codes up to max_code_length_ bits
+  int primary_table_bits(size_t symbols) const;
+  void update_single_lookup();
+
+  // Follow sub-table links after a primary lookup that missed a leaf
+  uint8_t decode_linked(FastBitReader& reader, const Entry& link) const;
+
+  // Fill a table from codes that share their first consumed bits
+  void fill_codes(const CodeEntry* begin, const CodeEntry* end,
+                  size_t table_offset, int table_bits, int consumed);
+
+  void fill_table(const HuffmanTree& tree, uint16_t node_index,
+                  size_t table_offset, int table_bits, uint32_t prefix,
+                  int depth);
+
+  static int subtree_height(const HuffmanTree& tree, uint16_t node_index);
+};
+
+#endif
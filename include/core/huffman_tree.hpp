@@ -1,36 +1,73 @@
 #ifndef HUFFMAN_TREE_HPP
 #define HUFFMAN_TREE_HPP
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <map>
-#include <memory>
 #include <string>
 
+#include "core/code_table.hpp"
+
 // Forward declaration
 class BitStream;
 
+// Huffman tree stored in a fixed node array: 256 leaves plus at most 255
+// internal nodes, linked by 16-bit indices, so building never allocates.
 class HuffmanTree {
  private:
+  static constexpr size_t kMaxNodes = 511;
+  static constexpr uint16_t kNoNode = 0xFFFF;
+
   struct Node {
-    uint8_t byte;
-    uint64_t frequency;
-    std::unique_ptr<Node> left;
-    std::unique_ptr<Node> right;
-    bool is_leaf;
-
-    Node(uint8_t b, uint64_t freq, bool leaf = false)
-        : byte(b), frequency(freq), is_leaf(leaf) {}
+    uint64_t frequency = 0;
+    uint16_t left = kNoNode;
+    uint16_t right = kNoNode;
+    uint8_t byte = 0;
+    bool is_leaf = false;
   };
 
-  std::unique_ptr<Node> root;
+  std::array<Node, kMaxNodes> nodes;
+  uint16_t num_nodes = 0;
+  uint16_t root = kNoNode;
+
+  // The decoder walks the tree once to build its lookup tables
+  friend class HuffmanDecoder;
+
+  uint16_t add_node(uint64_t frequency, uint16_t left, uint16_t right);
+  uint16_t add_leaf(uint8_t byte, uint64_t frequency);
+  // Wrap a lone leaf so its code is a single bit
+  void finish_tree(uint16_t top);
+  // Two-queue merge over the leaves already in the first node slots
+  void merge_leaves();
 
  public:
   HuffmanTree() = default;
   ~HuffmanTree() = default;
 
+  // Optimal tree from a two-queue merge over the leaves sorted by frequency
   void build_tree(const std::map<uint8_t, uint64_t>& frequencies);
+  // Same, straight from a 256-entry count array (zero counts are skipped)
+  void build_tree(const std::array<uint64_t, 256>& counts);
+  // Tree with the exact tie-breaking of the original priority-queue build.
+  // Formats that store frequencies must rebuild their tree this way.
+  void build_tree_compatible(const std::map<uint8_t, uint64_t>& frequencies);
+  bool empty() const { return root == kNoNode; }
+
+  // Packed code for every leaf, the form the encode loop consumes
+  CodeTable code_table() const;
+  // The same codes as '0'/'1' strings, for display
   std::map<uint8_t, std::string> generate_codes() const;
 
+  // Depth of every leaf, 0 for bytes not in the tree
+  std::array<uint8_t, 256> code_lengths() const;
+
+  // Optimal code lengths with no code longer than max_length bits, found
+  // with package-merge instead of a tree. max_length must leave room for
+  // every symbol (2^max_length >= number of symbols).
+  static std::array<uint8_t, 256> limited_code_lengths(
+      const std::map<uint8_t, uint64_t>& frequencies, int max_length);
+
   // Decode a single byte from the bit stream using the Huffman tree
   uint8_t decode_byte(BitStream& bit_stream) const;
 };
@@ -0,0 +1,66 @@
+#ifndef INPUT_SOURCE_HPP
+#define INPUT_SOURCE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
+
+// File name that stands for standard input (and, for Encoder, standard
+// output), as in shell pipelines
+inline bool is_standard_stream(const std::string& file_name) {
+  return file_name == "-";
+}
+
+// Read-only view of an input file. Regular files are memory-mapped with a
+// sequential access hint, so reads are pointer walks over the mapping;
+// pipes, devices, standard input ("-") and platforms without mmap fall
+// back to buffered reads.
+class InputSource {
+ public:
+  struct Span {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+  };
+
+  InputSource() = default;
+  explicit InputSource(const std::string& file_name) { open(file_name); }
+  ~InputSource() { close(); }
+
+  InputSource(const InputSource&) = delete;
+  InputSource& operator=(const InputSource&) = delete;
+
+  void open(const std::string& file_name);
+  void close();
+
+  // Next up to max_bytes of input, empty at the end. Mapped sources return
+  // a view into the mapping; buffered ones fill scratch and point into it.
+  Span read(size_t max_bytes, std::vector<uint8_t>& scratch);
+
+  // Drop the pages behind a span that is no longer needed, so mapped input
+  // does not accumulate in the resident set. Spans must be released in
+  // order, possibly from another thread than the one calling read().
+  void release(const Span& span);
+
+  // Start over from the beginning for another pass
+  void rewind();
+
+  bool is_mapped() const { return mapping_ != nullptr; }
+  bool size_known() const { return size_known_; }
+  uint64_t size() const { return size_; }  // 0 when not size_known()
+
+ private:
+  const uint8_t* mapping_ = nullptr;
+  size_t position_ = 0;
+  uint64_t size_ = 0;
+  bool size_known_ = false;
+  std::string file_name_;
+  std::ifstream file_;
+  std::istream* stream_ = nullptr;  // file_ or std::cin when not mapped
+
+  bool try_map(const std::string& file_name);
+};
+
+#endif
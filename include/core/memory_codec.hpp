@@ -0,0 +1,79 @@
+#ifndef MEMORY_CODEC_HPP
+#define MEMORY_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "core/block_codec.hpp"
+#include "core/container_format.hpp"
+#include "core/shared_table.hpp"
+
+// Buffer-to-buffer compression for embedding: the same .qcmp container as
+// Encoder::compress, produced from and decoded into memory with no file
+// I/O. An instance is a reusable context; keep one per thread and calls
+// after the first reuse its tables and scratch space.
+class MemoryCodec {
+ public:
+  static constexpr size_t kDefaultBlockSize = size_t{1} << 20;
+
+  MemoryCodec() = default;
+  ~MemoryCodec() = default;
+
+  // Largest compressed size of size input bytes at the given block size
+  static size_t compress_bound(size_t size,
+                               size_t block_size = kDefaultBlockSize);
+
+  // Replace out with the compressed form of data
+  void compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+  // Compress into a caller-owned buffer and return the bytes written.
+  // Throws if capacity is too small; compress_bound() is always enough.
+  size_t compress(const uint8_t* data, size_t size, uint8_t* out,
+                  size_t capacity);
+
+  // Decoded size recorded in a container, without decoding it
+  static uint64_t decompressed_size(const uint8_t* data, size_t size);
+
+  // Replace out with the decompressed contents of a container
+  void decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+  // Decompress into a caller-owned buffer and return the bytes written
+  size_t decompress(const uint8_t* data, size_t size, uint8_t* out,
+                    size_t capacity);
+
+  // Replace out with original bytes [offset, offset + length) of a
+  // container, cut short at the end of the data; only the blocks covering
+  // the range are decoded, found through the index
+  void decompress_range(const uint8_t* data, size_t size, uint64_t offset,
+                        uint64_t length, std::vector<uint8_t>& out);
+
+  void set_block_size(size_t bytes);
+  size_t block_size() const { return block_size_; }
+
+  // Cap on Huffman code lengths, 0 for unbounded (see BlockCodec)
+  void set_max_code_length(int bits);
+  int max_code_length() const { return block_codec_.max_code_length(); }
+
+  // Pre-trained table to code with and to decode blocks that use it
+  void set_shared_table(std::shared_ptr<const SharedTable> table);
+
+  // Let blocks use order-1 context tables when smaller (see BlockCodec)
+  void set_context_mode(bool enabled) {
+    block_codec_.set_context_mode(enabled);
+  }
+  bool context_mode() const { return block_codec_.context_mode(); }
+
+ private:
+  size_t block_size_ = kDefaultBlockSize;
+  BlockCodec block_codec_;
+  std::shared_ptr<const SharedTable> shared_table_;
+  std::vector<BlockIndexEntry> block_index_;
+
+  void compress_into(const uint8_t* data, size_t size, ByteSink out);
+  // Walk the block sequence, decoding into out when it is not null
+  static uint64_t walk_blocks(const uint8_t* data, size_t size,
+                              BlockCodec* codec, uint8_t* out,
+                              size_t capacity);
+};
+
+#endif
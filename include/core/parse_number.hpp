@@ -0,0 +1,17 @@
+#ifndef PARSE_NUMBER_HPP
+#define PARSE_NUMBER_HPP
+
+#include <charconv>
+#include <string>
+#include <system_error>
+
+// The whole of text as a number of type T; false for anything else,
+// including values out of T's range
+template <typename T>
+bool parse_number(const std::string& text, T& value) {
+  const char* end = text.data() + text.size();
+  auto [next, error] = std::from_chars(text.data(), end, value);
+  return !text.empty() && error == std::errc() && next == end;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef PROGRESS_REPORTER_HPP
+#define PROGRESS_REPORTER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace indicators {
+class ProgressBar;
+}
+
+// Progress bar kept off the coding threads: they only add to an atomic
+// counter, and a sampler thread redraws the bar from it at a fixed
+// interval. A disabled reporter starts no thread and draws nothing, so
+// add() is its whole cost.
+class ProgressReporter {
+ public:
+  enum class Kind { kCompress, kDecompress };
+
+  static constexpr std::chrono::milliseconds kInterval{100};
+
+  // total is the count that means done; 0 (unknown) disables the bar
+  ProgressReporter(Kind kind, uint64_t total, bool enabled,
+                   std::ostream& stream = std::cerr);
+  ~ProgressReporter();
+
+  ProgressReporter(const ProgressReporter&) = delete;
+  ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+  // Safe from any thread
+  void add(uint64_t count) {
+    done_.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  // Draw the bar full and stop the sampler
+  void finish();
+
+  bool enabled() const { return bar_ != nullptr; }
+
+  // Whether standard error is a terminal, where escape codes belong
+  static bool stderr_is_terminal();
+
+ private:
+  uint64_t total_;
+  std::atomic<uint64_t> done_{0};
+  std::unique_ptr<indicators::ProgressBar> bar_;
+
+  std::thread sampler_;
+  std::mutex mutex_;
+  std::condition_variable stop_requested_;
+  bool stopping_ = false;
+
+  void sample();
+  void stop();
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef SHARED_TABLE_HPP
+#define SHARED_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/canonical_code.hpp"
+#include "core/frequency_analyzer.hpp"
+#include "core/huffman_decoder.hpp"
+
+// Huffman table trained offline on a sample corpus (dictionary mode).
+// Blocks coded with it carry only the table ID instead of their own code
+// lengths, which pays off for small, homogeneous payloads. Every byte
+// value gets a code, so input unlike the samples still round-trips.
+//
+// Table file layout: magic "QTBL" (4) | version (1) | ID (4) |
+// serialized canonical code lengths
+class SharedTable {
+ public:
+  static constexpr int kDefaultMaxCodeLength = 15;
+
+  SharedTable() = default;
+  ~SharedTable() = default;
+
+  // Training: accumulate samples, then derive the code from their counts
+  void add_sample(const uint8_t* data, size_t size);
+  void add_sample_file(const std::string& file_name);
+  void train(int max_code_length = kDefaultMaxCodeLength);
+
+  void serialize(std::vector<uint8_t>& out) const;
+  void deserialize(const uint8_t* in, size_t size);
+  void save(const std::string& file_name) const;
+  void load(const std::string& file_name);
+
+  bool empty() const { return !ready_; }
+  // Fingerprint of the code lengths; blocks name their table by it
+  uint32_t id() const { return id_; }
+  const CanonicalCode& code() const { return code_; }
+  const HuffmanDecoder& decoder() const { return decoder_; }
+
+  static std::string format_id(uint32_t id);
+
+ private:
+  FrequencyAnalyzer::Histogram counts_{};
+  CanonicalCode code_;
+  HuffmanDecoder decoder_;
+  uint32_t id_ = 0;
+  bool ready_ = false;
+
+  void assign(const CanonicalCode::Lengths& lengths);
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads with a task deque each. A worker runs its own newest task
+// first and, once its deque is empty, steals the oldest task of another.
+// Tasks submitted from a worker land on that worker's deque, so a task that
+// fans out into many (a file split into blocks) keeps them local while idle
+// workers take the rest.
+class WorkStealingPool {
+ public:
+  // worker is the number of the thread running the task, 0 .. size() - 1
+  using Task = std::function<void(size_t worker)>;
+
+  explicit WorkStealingPool(size_t num_threads);
+  // Runs what is still queued, then joins the workers
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  // From outside the pool tasks go round-robin over the deques; from a
+  // task, onto the deque of the worker running it
+  void submit(Task task);
+
+  // Wait until every task, including those submitted by tasks, has run,
+  // then rethrow the first exception any of them threw. Not from a task.
+  void wait();
+
+  size_t size() const { return workers_.size(); }
+
+ private:
+  struct Deque {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Deque>> deques_;
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;  // guards everything below
+  std::condition_variable task_available_;
+  std::condition_variable all_done_;
+  size_t queued_ = 0;   // in some deque, at least
+  size_t pending_ = 0;  // submitted and not finished
+  size_t next_deque_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr error_;
+
+  // The worker's own newest task, else the oldest task of another deque
+  bool take(size_t worker, Task& task);
+  void worker_loop(size_t worker);
+};
+
+#endif
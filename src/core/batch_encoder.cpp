@@ -0,0 +1,494 @@
+#include "core/batch_encoder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "core/container_format.hpp"
+#include "core/input_source.hpp"
+#include "core/work_stealing_pool.hpp"
+
+namespace {
+
+// Small files are grouped into tasks of a quarter of each worker's share
+// of them, so the load still evens out, but never less than this much
+// input, so thousands of tiny files do not become thousands of tasks
+constexpr uint64_t kMinGroupBytes = 64 * 1024;
+
+bool has_extension(const std::string& name) {
+  const std::string extension = BatchEncoder::kExtension;
+  return name.size() > extension.size() &&
+         name.compare(name.size() - extension.size(), extension.size(),
+                      extension) == 0;
+}
+
+// Only the magic is read, so legacy files are not read twice
+bool is_container_file(const std::string& name) {
+  std::ifstream in(name, std::ios::binary);
+  uint8_t magic[4];
+  in.read(reinterpret_cast<char*>(magic), sizeof(magic));
+  return in.gcount() == sizeof(magic) && has_container_magic(magic);
+}
+
+}  // namespace
+
+struct BatchEncoder::FileJob {
+  std::string input_name;
+  std::string output_name;
+  bool compressing = true;
+  uint64_t listed_size = 0;  // from the directory, for scheduling
+
+  InputSource input;
+  InputSource::Span contents;    // the whole input
+  uint64_t input_bytes = 0;
+  std::vector<uint8_t> scratch;  // holds contents when not mapped
+  FileHeader header;             // of the output, or of the input
+  bool created_output = false;
+
+  struct Block {
+    InputSource::Span source;  // original bytes, or the body to decode
+    BlockHeader header;        // decompression only
+    std::vector<uint8_t> coded;
+    bool ready = false;
+  };
+  std::vector<Block> blocks;
+  std::atomic<size_t> next_block{0};
+  std::atomic<size_t> remaining{0};
+
+  // Set once, by the first failure; read after the pool is done
+  std::atomic<bool> failed{false};
+  std::string error;
+
+  std::mutex mutex;  // guards the output and everything below
+  std::condition_variable written;  // next_to_write moved on
+  std::ofstream output;
+  size_t next_to_write = 0;
+  uint64_t output_bytes = 0;
+  std::vector<BlockIndexEntry> index;
+
+  void fail(const std::string& reason) {
+    bool expected = false;
+    if (failed.compare_exchange_strong(expected, true)) {
+      error = reason;
+    }
+  }
+};
+
+BatchEncoder::BatchEncoder(int num_threads) : num_threads_(num_threads) {
+  if (num_threads < 1) {
+    throw std::invalid_argument("Number of threads must be at least 1");
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    auto worker = std::make_unique<Worker>();
+    worker->legacy.set_show_progress(false);
+    workers_.push_back(std::move(worker));
+  }
+}
+
+BatchEncoder::~BatchEncoder() = default;
+
+void BatchEncoder::set_block_size(size_t bytes) {
+  if (bytes == 0 || bytes > kMaxBlockSize) {
+    throw std::invalid_argument("Block size must be between 1 byte and " +
+                                std::to_string(kMaxBlockSize) + " bytes");
+  }
+  block_size_ = bytes;
+}
+
+void BatchEncoder::set_max_code_length(int bits) {
+  for (auto& worker : workers_) {
+    worker->codec.set_max_code_length(bits);
+  }
+  max_code_length_ = bits;
+}
+
+void BatchEncoder::set_shared_table(std::shared_ptr<const SharedTable> table) {
+  shared_table_ = std::move(table);
+  for (auto& worker : workers_) {
+    worker->codec.set_shared_table(shared_table_.get());
+    worker->legacy.set_shared_table(shared_table_);
+  }
+}
+
+void BatchEncoder::set_context_mode(bool enabled) {
+  for (auto& worker : workers_) {
+    worker->codec.set_context_mode(enabled);
+  }
+  context_mode_ = enabled;
+}
+
+std::vector<std::string> BatchEncoder::collect_inputs(
+    const std::vector<std::string>& paths, bool compressing) {
+  std::vector<std::string> inputs;
+  for (const auto& path : paths) {
+    if (!std::filesystem::is_directory(path)) {
+      inputs.push_back(path);
+      continue;
+    }
+    for (const auto& entry :
+         std::filesystem::recursive_directory_iterator(path)) {
+      if (entry.is_regular_file() &&
+          has_extension(entry.path().string()) != compressing) {
+        inputs.push_back(entry.path().string());
+      }
+    }
+  }
+  return inputs;
+}
+
+std::string BatchEncoder::output_name(const std::string& input,
+                                      bool compressing) {
+  if (compressing) {
+    return input + kExtension;
+  }
+  if (has_extension(input)) {
+    return input.substr(0, input.size() - std::string(kExtension).size());
+  }
+  return input + ".out";
+}
+
+BatchEncoder::Result BatchEncoder::compress(
+    const std::vector<std::string>& inputs) {
+  return run(inputs, true);
+}
+
+BatchEncoder::Result BatchEncoder::decompress(
+    const std::vector<std::string>& inputs) {
+  return run(inputs, false);
+}
+
+BatchEncoder::Result BatchEncoder::run(const std::vector<std::string>& inputs,
+                                       bool compressing) {
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::unique_ptr<FileJob>> jobs;
+  uint64_t total_bytes = 0;
+  for (const auto& input : inputs) {
+    auto job = std::make_unique<FileJob>();
+    job->input_name = input;
+    job->output_name = output_name(input, compressing);
+    job->compressing = compressing;
+    // Unreadable sizes count as small; opening the file reports the error
+    std::error_code error;
+    job->listed_size = std::filesystem::file_size(input, error);
+    if (error) {
+      job->listed_size = 0;
+    }
+    total_bytes += job->listed_size;
+    jobs.push_back(std::move(job));
+  }
+
+  for (auto& worker : workers_) {
+    worker->stats = CodecStats();
+    worker->codec.set_collect_stats(collect_stats_);
+    worker->codec.reset_stats();
+    worker->legacy.set_collect_stats(collect_stats_);
+  }
+
+  // Largest first, so the long files start early and small ones fill in
+  std::vector<FileJob*> order;
+  for (auto& job : jobs) {
+    order.push_back(job.get());
+  }
+  std::stable_sort(order.begin(), order.end(), [](FileJob* a, FileJob* b) {
+    return a->listed_size > b->listed_size;
+  });
+
+  const uint64_t split_size = uint64_t{kSplitBlocks} * block_size_;
+  uint64_t small_bytes = 0;
+  for (FileJob* job : order) {
+    if (job->listed_size < split_size) {
+      small_bytes += job->listed_size;
+    }
+  }
+  const uint64_t group_bytes = std::min(
+      std::max(small_bytes / (4 * workers_.size()), kMinGroupBytes),
+      split_size);
+
+  ProgressReporter progress(
+      compressing ? ProgressReporter::Kind::kCompress
+                  : ProgressReporter::Kind::kDecompress,
+      total_bytes, show_progress_ && ProgressReporter::stderr_is_terminal());
+  {
+    WorkStealingPool pool(workers_.size());
+
+    // A large file opens on one worker and fans out into a block runner
+    // per worker, which idle workers steal; runners claim blocks in order
+    // and stay within blocks_ahead() of the writer, so few coded blocks
+    // ever wait to be written
+    size_t next = 0;
+    for (; next < order.size() && order[next]->listed_size >= split_size;
+         ++next) {
+      FileJob* job = order[next];
+      pool.submit([this, job, &pool, &progress](size_t worker) {
+        if (!open_job(*job, *workers_[worker], progress)) {
+          return;
+        }
+        size_t runners = std::min(workers_.size(), job->blocks.size());
+        for (size_t i = 1; i < runners; ++i) {
+          pool.submit([this, job, &progress](size_t worker) {
+            code_blocks(*job, *workers_[worker], progress);
+          });
+        }
+        code_blocks(*job, *workers_[worker], progress);
+      });
+    }
+
+    // Small files a group at a time, each coded whole by one worker
+    while (next < order.size()) {
+      std::vector<FileJob*> group;
+      uint64_t bytes = 0;
+      while (next < order.size() && (group.empty() || bytes < group_bytes)) {
+        bytes += order[next]->listed_size;
+        group.push_back(order[next++]);
+      }
+      pool.submit([this, group, &progress](size_t worker) {
+        for (FileJob* job : group) {
+          if (open_job(*job, *workers_[worker], progress)) {
+            code_blocks(*job, *workers_[worker], progress);
+          }
+        }
+      });
+    }
+
+    pool.wait();
+  }
+  progress.finish();
+
+  Result result;
+  result.stats.compressing = compressing;
+  result.stats.threads = num_threads_;
+  result.stats.io_threads = num_threads_;
+  for (const auto& job : jobs) {
+    if (job->failed) {
+      result.failures.push_back(job->input_name + ": " + job->error);
+      continue;
+    }
+    ++result.files;
+    uint64_t input_bytes = job->input_bytes;
+    result.stats.original_bytes +=
+        compressing ? input_bytes : job->output_bytes;
+    result.stats.compressed_bytes +=
+        compressing ? job->output_bytes : input_bytes;
+  }
+  for (const auto& worker : workers_) {
+    result.stats.add_stages(worker->stats);
+    result.stats.add_stages(worker->codec.stats());
+  }
+  result.stats.wall_seconds = std::chrono::duration<double>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+  return result;
+}
+
+bool BatchEncoder::open_job(FileJob& job, Worker& worker,
+                            ProgressReporter& progress) {
+  StageClock clock(collect_stats_ ? &worker.stats : nullptr);
+  try {
+    if (!std::filesystem::is_regular_file(job.input_name)) {
+      throw std::runtime_error("Not a regular file");
+    }
+    if (!overwrite_ && std::filesystem::exists(job.output_name)) {
+      throw std::runtime_error("Output file already exists: " +
+                               job.output_name);
+    }
+    if (!job.compressing && !is_container_file(job.input_name)) {
+      // Legacy files carry no blocks to share out; Encoder reads and
+      // decodes them as one
+      job.input_bytes = std::filesystem::file_size(job.input_name);
+      job.created_output = true;
+      worker.legacy.decompress(job.input_name, job.output_name);
+      if (collect_stats_) {
+        worker.stats.add_stages(worker.legacy.stats());
+        ++worker.stats.blocks;
+      }
+      job.output_bytes = std::filesystem::file_size(job.output_name);
+      progress.add(job.input_bytes);
+      return false;
+    }
+
+    job.input.open(job.input_name);
+    job.contents = job.input.read(job.input.size(), job.scratch);
+    job.input_bytes = job.contents.size;
+    clock.lap(CodecStats::kRead, job.contents.size);
+
+    const uint8_t* data = job.contents.data;
+    const size_t size = job.contents.size;
+
+    job.output.open(job.output_name, std::ios::binary | std::ios::trunc);
+    if (!job.output.is_open()) {
+      throw std::runtime_error("Could not open output file: " +
+                               job.output_name);
+    }
+    job.created_output = true;
+
+    if (job.compressing) {
+      // A single block has nothing to index
+      job.header.block_size = static_cast<uint32_t>(block_size_);
+      if (size > block_size_) {
+        job.header.flags = kFlagBlockIndex;
+      }
+      std::vector<uint8_t> file_header;
+      append_file_header(file_header, job.header);
+      job.output.write(reinterpret_cast<const char*>(file_header.data()),
+                       file_header.size());
+      job.output_bytes = file_header.size();
+
+      job.blocks.resize((size + block_size_ - 1) / block_size_);
+      for (size_t i = 0; i < job.blocks.size(); ++i) {
+        size_t offset = i * block_size_;
+        job.blocks[i].source = {data + offset,
+                                std::min(block_size_, size - offset)};
+      }
+    } else {
+      if (size < kFileHeaderSize || !has_container_magic(data)) {
+        throw std::runtime_error("Truncated container header");
+      }
+      job.header = load_file_header(data + 4);
+      if (job.header.version != kContainerVersion) {
+        throw std::runtime_error("Unsupported container version: " +
+                                 std::to_string(job.header.version));
+      }
+
+      // Walk the block headers up to the end marker; bodies stay mapped
+      size_t position = kFileHeaderSize;
+      for (;;) {
+        if (size - position < BlockHeader::kSize) {
+          throw std::runtime_error("Truncated block header");
+        }
+        BlockHeader header = load_block_header(data + position);
+        position += BlockHeader::kSize;
+        if (header.original_size == 0) {
+          break;
+        }
+        if (header.original_size > job.header.block_size ||
+            header.compressed_size > size - position) {
+          throw std::runtime_error("Corrupt block header");
+        }
+        FileJob::Block block;
+        block.source = {data + position, header.compressed_size};
+        block.header = header;
+        job.blocks.push_back(std::move(block));
+        position += header.compressed_size;
+      }
+    }
+  } catch (const std::exception& e) {
+    job.fail(e.what());
+  }
+
+  job.remaining = job.blocks.size();
+  if (job.failed || job.blocks.empty()) {
+    progress.add(job.contents.size);
+    finish_job(job, worker);
+    return false;
+  }
+  return true;
+}
+
+void BatchEncoder::code_blocks(FileJob& job, Worker& worker,
+                               ProgressReporter& progress) {
+  const size_t window = blocks_ahead();
+  for (size_t i = job.next_block++; i < job.blocks.size();
+       i = job.next_block++) {
+    // Whoever holds the block due is never held back here, so it is always
+    // being coded and the wait ends
+    if (i >= window) {
+      std::unique_lock<std::mutex> lock(job.mutex);
+      job.written.wait(lock, [&] { return i < job.next_to_write + window; });
+    }
+
+    FileJob::Block& block = job.blocks[i];
+    if (!job.failed) {
+      try {
+        if (job.compressing) {
+          worker.codec.encode_block(block.source.data, block.source.size,
+                                    block.coded);
+        } else {
+          block.coded.resize(block.header.original_size);
+          worker.codec.decode_block(block.header, block.source.data,
+                                    block.coded.data());
+        }
+      } catch (const std::exception& e) {
+        job.fail(e.what());
+      }
+    }
+    progress.add(block.source.size);
+
+    {
+      std::lock_guard<std::mutex> lock(job.mutex);
+      block.ready = true;
+      write_ready_blocks(job, worker);
+    }
+    if (--job.remaining == 0) {
+      finish_job(job, worker);
+    }
+  }
+}
+
+void BatchEncoder::write_ready_blocks(FileJob& job, Worker& worker) {
+  StageClock clock(collect_stats_ ? &worker.stats : nullptr);
+  const size_t first = job.next_to_write;
+  while (job.next_to_write < job.blocks.size() &&
+         job.blocks[job.next_to_write].ready) {
+    FileJob::Block& block = job.blocks[job.next_to_write++];
+    if (!job.failed) {
+      if (job.compressing) {
+        BlockIndexEntry entry;
+        entry.offset = job.output_bytes;
+        entry.stored_size = static_cast<uint32_t>(block.coded.size());
+        entry.original_size = static_cast<uint32_t>(block.source.size);
+        job.index.push_back(entry);
+      }
+      job.output.write(reinterpret_cast<const char*>(block.coded.data()),
+                       block.coded.size());
+      if (!job.output) {
+        job.fail("Failed to write output file: " + job.output_name);
+      }
+      job.output_bytes += block.coded.size();
+    }
+    clock.lap(CodecStats::kWrite, block.coded.size());
+
+    job.input.release(block.source);
+    std::vector<uint8_t>().swap(block.coded);
+  }
+  if (job.next_to_write != first) {
+    job.written.notify_all();
+  }
+}
+
+void BatchEncoder::finish_job(FileJob& job, Worker& worker) {
+  StageClock clock(collect_stats_ ? &worker.stats : nullptr);
+  if (!job.failed && job.compressing) {
+    std::vector<uint8_t> tail;
+    append_block_header(tail, BlockHeader{});
+    if (job.header.flags & kFlagBlockIndex) {
+      append_block_index(tail, job.index, job.output_bytes + tail.size());
+    }
+    job.output.write(reinterpret_cast<const char*>(tail.data()),
+                     tail.size());
+    job.output_bytes += tail.size();
+    clock.lap(CodecStats::kWrite, tail.size());
+  }
+  if (job.output.is_open()) {
+    job.output.close();
+    if (!job.output) {
+      job.fail("Failed to write output file: " + job.output_name);
+    }
+  }
+
+  job.input.close();
+  job.blocks = std::vector<FileJob::Block>();
+  job.index = std::vector<BlockIndexEntry>();
+  job.scratch = std::vector<uint8_t>();
+  if (job.failed && job.created_output) {
+    std::error_code error;
+    std::filesystem::remove(job.output_name, error);
+  }
+}
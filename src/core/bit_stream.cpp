@@ -54,6 +54,46 @@ uint32_t BitStream::read_bits(int count) {
   return result;
 }
 
+uint32_t BitStream::peek_bits(int count) const {
+  if (count < 0 || count > 32) {
+    throw std::invalid_argument("BitStream: Count must be between 0 and 32");
+  }
+  if (count == 0) {
+    return 0;
+  }
+
+  // Gather the 5 bytes covering any 32-bit window at this position
+  size_t byte_index = read_position_ / 8;
+  uint64_t window = 0;
+  if (byte_index + 5 <= buffer_.size()) {
+    const uint8_t* p = buffer_.data() + byte_index;
+    window = (uint64_t{p[0]} << 32) | (uint64_t{p[1]} << 24) |
+             (uint64_t{p[2]} << 16) | (uint64_t{p[3]} << 8) | p[4];
+  } else {
+    for (size_t i = 0; i < 5; ++i) {
+      window <<= 8;
+      if (byte_index + i < buffer_.size()) {
+        window |= buffer_[byte_index + i];
+      }
+    }
+  }
+
+  window <<= read_position_ % 8;
+  return static_cast<uint32_t>((window >> (40 - count)) &
+                               ((uint64_t{1} << count) - 1));
+}
+
+void BitStream::skip_bits(int count) {
+  if (count < 0) {
+    throw std::invalid_argument("BitStream: Count must not be negative");
+  }
+  if (read_position_ + static_cast<size_t>(count) > bit_position_) {
+    throw std::runtime_error("BitStream: End of stream reached");
+  }
+
+  read_position_ += count;
+}
+
 void BitStream::writeByte(uint8_t byte) { write_bits(byte, 8); }
 
 uint8_t BitStream::readByte() { return static_cast<uint8_t>(read_bits(8)); }
@@ -0,0 +1,446 @@
+#include "core/block_codec.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+void BlockCodec::set_max_code_length(int bits) {
+  if (bits != 0 && (bits < 8 || bits > CanonicalCode::kMaxCodeLength)) {
+    throw std::invalid_argument(
+        "BlockCodec: Code length limit must be 0 or between 8 and 64");
+  }
+  max_code_length_ = bits;
+}
+
+void BlockCodec::encode_block(const uint8_t* data, size_t size, ByteSink out) {
+  if (size == 0 || size > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument("BlockCodec: Invalid block size");
+  }
+  StageClock clock(collect_stats_ ? &stats_ : nullptr);
+  if (collect_stats_) {
+    ++stats_.blocks;
+  }
+
+  FrequencyAnalyzer::Histogram histogram{};
+  if (context_mode_) {
+    context_model_.count(data, size);
+    histogram = context_model_.order0();
+  } else {
+    FrequencyAnalyzer::count(data, size, histogram);
+  }
+  clock.lap(CodecStats::kHistogram, size);
+
+  // No prefix code beats the entropy, so the entropy plus the smallest
+  // possible table bounds every per-block code from below
+  size_t num_symbols = 0;
+  for (uint64_t count : histogram) {
+    num_symbols += count > 0;
+  }
+  double min_size = FrequencyAnalyzer::entropy_bits(histogram) / 8 +
+                    CanonicalCode::min_serialized_size(num_symbols);
+  if (context_mode_) {
+    // Order-1 codes are bounded by the conditional entropy instead
+    min_size = std::min(min_size,
+                        context_model_.conditional_entropy_bits() / 8 + 1 +
+                            ContextModel::kSerializedMapSize +
+                            CanonicalCode::min_serialized_size(1));
+  }
+
+  // The trained table skips the tree when no table of the block's own
+  // could do much better; otherwise it competes on exact sizes below
+  uint64_t shared_bits = 0;
+  size_t shared_size = std::numeric_limits<size_t>::max();
+  if (shared_table_) {
+    const CanonicalCode::Lengths& lengths = shared_table_->code().lengths();
+    for (size_t symbol = 0; symbol < 256; ++symbol) {
+      shared_bits += histogram[symbol] * lengths[symbol];
+    }
+    shared_size = (shared_bits + 7) / 8 + 4;
+    if (shared_size < size &&
+        shared_size <= min_size + min_size / kSharedTableSlack) {
+      encode_shared_block(data, size, shared_bits, out);
+      clock.lap(CodecStats::kEncode, size);
+      return;
+    }
+  }
+
+  // When even the bound cannot shrink the block, skip the tree
+  if (min_size >= size) {
+    if (shared_size < size) {
+      encode_shared_block(data, size, shared_bits, out);
+    } else {
+      encode_stored_block(data, size, out);
+    }
+    clock.lap(CodecStats::kEncode, size);
+    return;
+  }
+
+  CanonicalCode::Lengths lengths = code_lengths(histogram);
+  canonical_code_.assign(lengths);
+
+  // Exact size from the code lengths, before spending time on the bits
+  uint64_t encoded_bits = 0;
+  for (size_t symbol = 0; symbol < 256; ++symbol) {
+    encoded_bits += histogram[symbol] * lengths[symbol];
+  }
+  bool interleave = size >= kMinInterleavedBlockSize;
+  size_t order0_size =
+      (encoded_bits + 7) / 8 + canonical_code_.serialized_size();
+  if (interleave) {
+    // Each stream may pad its last byte
+    order0_size += kJumpTableSize + kInterleavedStreams - 1;
+  }
+
+  if (context_mode_) {
+    uint64_t context_bits = 0;
+    size_t context_size = plan_context_block(context_bits);
+    clock.lap(CodecStats::kTree, size);
+    if (context_size < std::min({order0_size, shared_size, size})) {
+      encode_context_block(data, size, context_bits, out);
+      clock.lap(CodecStats::kEncode, size);
+      return;
+    }
+  } else {
+    clock.lap(CodecStats::kTree, size);
+  }
+  if (shared_size <= order0_size && shared_size < size) {
+    encode_shared_block(data, size, shared_bits, out);
+    clock.lap(CodecStats::kEncode, size);
+    return;
+  }
+  if (order0_size >= size) {
+    encode_stored_block(data, size, out);
+    clock.lap(CodecStats::kEncode, size);
+    return;
+  }
+
+  // Header first; compressed_size is patched once the body is known
+  size_t header_offset = out.size();
+  BlockHeader header;
+  header.original_size = static_cast<uint32_t>(size);
+  header.type = interleave ? BlockType::kHuffmanInterleaved
+                           : BlockType::kHuffmanCanonical;
+  append_block_header(out, header);
+  size_t body_offset = out.size();
+
+  canonical_code_.serialize(out);
+  if (interleave) {
+    encode_interleaved(data, size, canonical_code_.table(), encoded_bits,
+                       out);
+  } else {
+    encode_bits(data, size, canonical_code_.table(), encoded_bits, out);
+  }
+  patch_body_size(out, header_offset, body_offset);
+  clock.lap(CodecStats::kEncode, size);
+}
+
+CanonicalCode::Lengths BlockCodec::code_lengths(
+    const FrequencyAnalyzer::Histogram& histogram) {
+  huffman_tree_.build_tree(histogram);
+  CanonicalCode::Lengths lengths = huffman_tree_.code_lengths();
+
+  // Only skewed blocks outgrow the limit; the tree is optimal otherwise
+  if (max_code_length_ > 0 &&
+      *std::max_element(lengths.begin(), lengths.end()) > max_code_length_) {
+    lengths = HuffmanTree::limited_code_lengths(
+        FrequencyAnalyzer::to_map(histogram), max_code_length_);
+  }
+  return lengths;
+}
+
+void BlockCodec::encode_shared_block(const uint8_t* data, size_t size,
+                                     uint64_t encoded_bits,
+                                     ByteSink out) {
+  size_t header_offset = out.size();
+  BlockHeader header;
+  header.original_size = static_cast<uint32_t>(size);
+  header.type = BlockType::kHuffmanShared;
+  append_block_header(out, header);
+  size_t body_offset = out.size();
+
+  append_u32(out, shared_table_->id());
+  encode_bits(data, size, shared_table_->code().table(), encoded_bits, out);
+  patch_body_size(out, header_offset, body_offset);
+}
+
+void BlockCodec::encode_stored_block(const uint8_t* data, size_t size,
+                                     ByteSink out) {
+  BlockHeader header;
+  header.original_size = static_cast<uint32_t>(size);
+  header.compressed_size = static_cast<uint32_t>(size);
+  header.type = BlockType::kStored;
+  append_block_header(out, header);
+  out.append(data, size);
+}
+
+size_t BlockCodec::plan_context_block(uint64_t& encoded_bits) {
+  context_codes_.resize(ContextModel::kMaxClusters);
+  trial_codes_.resize(ContextModel::kMaxClusters);
+
+  // More clusters fit the statistics better but each costs a table; the
+  // sizes are exact, so just try a few counts
+  size_t best_size = std::numeric_limits<size_t>::max();
+  ContextModel::ContextMap map;
+  for (size_t max_clusters = 2; max_clusters <= ContextModel::kMaxClusters;
+       max_clusters *= 2) {
+    size_t num_clusters =
+        context_model_.cluster(max_clusters, map, cluster_histograms_);
+
+    size_t table_size = 1 + ContextModel::kSerializedMapSize;
+    uint64_t bits = 0;
+    for (size_t c = 0; c < num_clusters; ++c) {
+      const FrequencyAnalyzer::Histogram& histogram = cluster_histograms_[c];
+      CanonicalCode::Lengths lengths = code_lengths(histogram);
+      trial_codes_[c].assign(lengths);
+      table_size += trial_codes_[c].serialized_size();
+      for (size_t symbol = 0; symbol < 256; ++symbol) {
+        bits += histogram[symbol] * lengths[symbol];
+      }
+    }
+
+    size_t trial_size = table_size + (bits + 7) / 8;
+    if (trial_size < best_size) {
+      best_size = trial_size;
+      encoded_bits = bits;
+      context_map_ = map;
+      num_context_codes_ = num_clusters;
+      std::swap(context_codes_, trial_codes_);
+    }
+    // Every context already had the clusters it could use
+    if (num_clusters < max_clusters) {
+      break;
+    }
+  }
+  return best_size;
+}
+
+void BlockCodec::encode_context_block(const uint8_t* data, size_t size,
+                                      uint64_t encoded_bits,
+                                      ByteSink out) {
+  size_t header_offset = out.size();
+  BlockHeader header;
+  header.original_size = static_cast<uint32_t>(size);
+  header.type = BlockType::kHuffmanContext;
+  append_block_header(out, header);
+  size_t body_offset = out.size();
+
+  out.push_back(static_cast<uint8_t>(num_context_codes_));
+  ContextModel::serialize_map(context_map_, out);
+  for (size_t c = 0; c < num_context_codes_; ++c) {
+    context_codes_[c].serialize(out);
+  }
+
+  const Code* tables[256];
+  for (size_t context = 0; context < 256; ++context) {
+    tables[context] = context_codes_[context_map_[context]].table().data();
+  }
+
+  bit_writer_.clear();
+  bit_writer_.reserve((encoded_bits + 7) / 8);
+  uint8_t previous = 0;
+  for (size_t i = 0; i < size; ++i) {
+    const Code& code = tables[previous][data[i]];
+    bit_writer_.write_bits(code.bits, code.length);
+    previous = data[i];
+  }
+  bit_writer_.flush();
+  out.append(bit_writer_.data(), bit_writer_.byte_size());
+  patch_body_size(out, header_offset, body_offset);
+}
+
+void BlockCodec::encode_bits(const uint8_t* data, size_t size,
+                             const CodeTable& table, uint64_t encoded_bits,
+                             ByteSink out) {
+  bit_writer_.clear();
+  bit_writer_.reserve((encoded_bits + 7) / 8);
+
+  for (size_t i = 0; i < size; ++i) {
+    const Code& code = table[data[i]];
+    bit_writer_.write_bits(code.bits, code.length);
+  }
+  bit_writer_.flush();
+  out.append(bit_writer_.data(), bit_writer_.byte_size());
+}
+
+void BlockCodec::encode_interleaved(const uint8_t* data, size_t size,
+                                    const CodeTable& table,
+                                    uint64_t encoded_bits,
+                                    ByteSink out) {
+  size_t jump_offset = out.size();
+  out.grow(kJumpTableSize);
+
+  size_t run = size / kInterleavedStreams;
+  for (size_t stream = 0; stream < kInterleavedStreams; ++stream) {
+    size_t begin = stream * run;
+    size_t end = stream + 1 < kInterleavedStreams ? begin + run : size;
+    size_t stream_offset = out.size();
+    encode_bits(data + begin, end - begin, table,
+                encoded_bits / kInterleavedStreams, out);
+    if (stream + 1 < kInterleavedStreams) {
+      store_u32(out.data() + jump_offset + 4 * stream,
+                static_cast<uint32_t>(out.size() - stream_offset));
+    }
+  }
+}
+
+void BlockCodec::patch_body_size(ByteSink out, size_t header_offset,
+                                 size_t body_offset) {
+  size_t body_size = out.size() - body_offset;
+  if (body_size > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("BlockCodec: Encoded block too large");
+  }
+  store_u32(out.data() + header_offset + 4, static_cast<uint32_t>(body_size));
+}
+
+void BlockCodec::decode_block(const BlockHeader& header, const uint8_t* body,
+                              uint8_t* out) {
+  StageClock clock(collect_stats_ ? &stats_ : nullptr);
+  if (collect_stats_) {
+    ++stats_.blocks;
+  }
+
+  switch (header.type) {
+    case BlockType::kHuffmanCanonical: {
+      size_t table_size =
+          canonical_code_.deserialize(body, header.compressed_size);
+      huffman_decoder_.build(canonical_code_, header.original_size);
+
+      FastBitReader bit_reader(body + table_size,
+                               header.compressed_size - table_size);
+      huffman_decoder_.decode(bit_reader, out, header.original_size);
+      break;
+    }
+    case BlockType::kHuffmanInterleaved:
+      decode_interleaved_block(header, body, out);
+      break;
+    case BlockType::kHuffmanShared: {
+      if (header.compressed_size < 4) {
+        throw std::runtime_error("BlockCodec: Truncated block table");
+      }
+      uint32_t id = load_u32(body);
+      if (!shared_table_ || shared_table_->id() != id) {
+        throw std::runtime_error("BlockCodec: Block needs shared table " +
+                                 SharedTable::format_id(id));
+      }
+      FastBitReader bit_reader(body + 4, header.compressed_size - 4);
+      shared_table_->decoder().decode(bit_reader, out, header.original_size);
+      break;
+    }
+    case BlockType::kStored:
+      if (header.compressed_size != header.original_size) {
+        throw std::runtime_error("BlockCodec: Corrupt stored block");
+      }
+      std::memcpy(out, body, header.original_size);
+      break;
+    case BlockType::kHuffmanContext:
+      decode_context_block(header, body, out);
+      break;
+    case BlockType::kHuffman:
+      decode_frequency_block(header, body, out);
+      break;
+    default:
+      throw std::runtime_error(
+          "BlockCodec: Unknown block type " +
+          std::to_string(static_cast<int>(header.type)));
+  }
+  clock.lap(CodecStats::kDecode, header.original_size);
+}
+
+void BlockCodec::decode_frequency_block(const BlockHeader& header,
+                                        const uint8_t* body, uint8_t* out) {
+  if (header.compressed_size < 2) {
+    throw std::runtime_error("BlockCodec: Truncated block table");
+  }
+
+  size_t num_symbols = load_u16(body);
+  size_t table_size = 2 + num_symbols * 5;
+  if (num_symbols == 0 || num_symbols > 256 ||
+      table_size > header.compressed_size) {
+    throw std::runtime_error("BlockCodec: Corrupt block table");
+  }
+
+  std::map<uint8_t, uint64_t> frequencies;
+  uint64_t total = 0;
+  for (size_t i = 0; i < num_symbols; ++i) {
+    const uint8_t* entry = body + 2 + i * 5;
+    uint32_t count = load_u32(entry + 1);
+    frequencies[entry[0]] = count;
+    total += count;
+  }
+  if (total != header.original_size) {
+    throw std::runtime_error("BlockCodec: Block table does not match size");
+  }
+
+  huffman_tree_.build_tree_compatible(frequencies);
+  huffman_decoder_.build(huffman_tree_);
+
+  FastBitReader bit_reader(body + table_size,
+                           header.compressed_size - table_size);
+  huffman_decoder_.decode(bit_reader, out, header.original_size);
+}
+
+void BlockCodec::decode_context_block(const BlockHeader& header,
+                                      const uint8_t* body, uint8_t* out) {
+  if (header.compressed_size < 1 + ContextModel::kSerializedMapSize) {
+    throw std::runtime_error("BlockCodec: Truncated block table");
+  }
+  size_t num_clusters = body[0];
+  if (num_clusters == 0 || num_clusters > ContextModel::kMaxClusters) {
+    throw std::runtime_error("BlockCodec: Corrupt block table");
+  }
+  ContextModel::deserialize_map(body + 1, num_clusters, context_map_);
+
+  context_codes_.resize(ContextModel::kMaxClusters);
+  context_decoders_.resize(ContextModel::kMaxClusters);
+  size_t offset = 1 + ContextModel::kSerializedMapSize;
+  for (size_t c = 0; c < num_clusters; ++c) {
+    offset += context_codes_[c].deserialize(body + offset,
+                                            header.compressed_size - offset);
+    context_decoders_[c].build(context_codes_[c],
+                               header.original_size / num_clusters);
+  }
+
+  const HuffmanDecoder* decoders[256];
+  for (size_t context = 0; context < 256; ++context) {
+    decoders[context] = &context_decoders_[context_map_[context]];
+  }
+
+  FastBitReader reader(body + offset, header.compressed_size - offset);
+  HuffmanDecoder::decode_order1(decoders, reader, out, header.original_size);
+}
+
+void BlockCodec::decode_interleaved_block(const BlockHeader& header,
+                                          const uint8_t* body, uint8_t* out) {
+  size_t table_size = canonical_code_.deserialize(body, header.compressed_size);
+  if (header.compressed_size - table_size < kJumpTableSize) {
+    throw std::runtime_error("BlockCodec: Truncated block table");
+  }
+  huffman_decoder_.build(canonical_code_, header.original_size);
+
+  const uint8_t* jump_table = body + table_size;
+  size_t run = header.original_size / kInterleavedStreams;
+  size_t stream_offset = table_size + kJumpTableSize;
+  FastBitReader readers[kInterleavedStreams];
+  uint8_t* outs[kInterleavedStreams];
+  for (size_t stream = 0; stream < kInterleavedStreams; ++stream) {
+    size_t remaining = header.compressed_size - stream_offset;
+    size_t stream_size = stream + 1 < kInterleavedStreams
+                             ? load_u32(jump_table + 4 * stream)
+                             : remaining;
+    if (stream_size > remaining) {
+      throw std::runtime_error("BlockCodec: Corrupt jump table");
+    }
+    readers[stream].reset(body + stream_offset, stream_size);
+    outs[stream] = out + stream * run;
+    stream_offset += stream_size;
+  }
+
+  huffman_decoder_.decode_interleaved(readers, outs, run);
+  // The last run carries the remainder
+  const size_t last = kInterleavedStreams - 1;
+  huffman_decoder_.decode(readers[last], outs[last] + run,
+                          header.original_size - kInterleavedStreams * run);
+}
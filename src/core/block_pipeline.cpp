@@ -0,0 +1,103 @@
+#include "core/block_pipeline.hpp"
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+
+#include "core/bounded_queue.hpp"
+#include "core/thread_pool.hpp"
+
+BlockPipeline::BlockPipeline(size_t num_coders, size_t num_slots)
+    : num_coders_(num_coders) {
+  if (num_coders == 0) {
+    throw std::invalid_argument("BlockPipeline: Need at least one coder");
+  }
+  slots_.resize(num_slots > 0 ? num_slots : 2 * num_coders + 2);
+}
+
+void BlockPipeline::run(const ReadFn& read, const CodeFn& code,
+                        const WriteFn& write) {
+  const size_t num_slots = slots_.size();
+  BoundedQueue<Slot*> free_slots(num_slots);
+  BoundedQueue<Slot*> to_code(num_slots);
+  BoundedQueue<Slot*> to_write(num_slots);
+  for (auto& slot : slots_) {
+    free_slots.push(&slot);
+  }
+
+  // A failing stage closes every queue so the others stop waiting
+  auto stop_all = [&] {
+    free_slots.close();
+    to_code.close();
+    to_write.close();
+  };
+
+  // Declared after the queues so its threads are joined before they go
+  ThreadPool pool(num_coders_ + 1);
+  std::vector<std::future<void>> stages;
+
+  stages.push_back(pool.submit([&] {
+    try {
+      Slot* slot = nullptr;
+      for (uint64_t sequence = 0; free_slots.pop(slot); ++sequence) {
+        slot->sequence = sequence;
+        if (!read(*slot) || !to_code.push(slot)) {
+          break;
+        }
+      }
+      to_code.close();
+    } catch (...) {
+      stop_all();
+      throw;
+    }
+  }));
+
+  std::atomic<size_t> active_coders{num_coders_};
+  for (size_t coder = 0; coder < num_coders_; ++coder) {
+    stages.push_back(pool.submit([&, coder] {
+      try {
+        Slot* slot = nullptr;
+        while (to_code.pop(slot)) {
+          code(*slot, coder);
+          if (!to_write.push(slot)) {
+            break;
+          }
+        }
+      } catch (...) {
+        stop_all();
+        throw;
+      }
+      // The last coder out tells the writer nothing more is coming
+      if (--active_coders == 0) {
+        to_write.close();
+      }
+    }));
+  }
+
+  // Coders finish out of order; every sequence in flight is within
+  // num_slots of the next one to write, so a ring puts them back in order
+  try {
+    std::vector<Slot*> ready(num_slots, nullptr);
+    uint64_t next = 0;
+    Slot* slot = nullptr;
+    while (to_write.pop(slot)) {
+      ready[slot->sequence % num_slots] = slot;
+      while (Slot* in_order = ready[next % num_slots]) {
+        ready[next % num_slots] = nullptr;
+        write(*in_order);
+        ++next;
+        free_slots.push(in_order);
+      }
+    }
+  } catch (...) {
+    stop_all();
+    for (auto& stage : stages) {
+      stage.wait();
+    }
+    throw;
+  }
+
+  for (auto& stage : stages) {
+    stage.get();
+  }
+}
@@ -0,0 +1,159 @@
+#include "core/canonical_code.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "core/fast_bit_stream.hpp"
+
+void CanonicalCode::assign(const Lengths& lengths) {
+  std::array<uint64_t, kMaxCodeLength + 1> length_counts{};
+  int max_length = 0;
+  for (uint8_t length : lengths) {
+    if (length > kMaxCodeLength) {
+      throw std::runtime_error("CanonicalCode: Code length exceeds " +
+                               std::to_string(kMaxCodeLength) + " bits");
+    }
+    if (length > 0) {
+      length_counts[length]++;
+      max_length = std::max<int>(max_length, length);
+    }
+  }
+  if (max_length == 0) {
+    throw std::runtime_error("CanonicalCode: No symbols");
+  }
+
+  // First code of each length; running out of codes means the lengths
+  // are over-subscribed and no prefix code exists
+  std::array<uint64_t, kMaxCodeLength + 1> next_code{};
+  uint64_t code = 0;
+  for (int length = 1; length <= max_length; ++length) {
+    uint64_t used = code + length_counts[length - 1];
+    code = used << 1;
+    // Codes left at this length. 2^64 does not fit, so at 64 bits a full
+    // previous level leaves nothing and an empty one more than enough
+    uint64_t available;
+    if (length < 64) {
+      available = (uint64_t{1} << length) - code;
+    } else if (used >> 63) {
+      available = 0;
+    } else {
+      available = code == 0 ? UINT64_MAX : 0 - code;
+    }
+    if (length_counts[length] > available) {
+      throw std::runtime_error(
+          "CanonicalCode: Lengths do not form a prefix code");
+    }
+    next_code[length] = code;
+  }
+
+  lengths_ = lengths;
+  max_length_ = max_length;
+  for (size_t symbol = 0; symbol < 256; ++symbol) {
+    table_[symbol].bits = lengths[symbol] ? next_code[lengths[symbol]]++ : 0;
+    table_[symbol].length = lengths[symbol];
+  }
+}
+
+int CanonicalCode::packed_width(int max_length) {
+  int width = 0;
+  while ((1 << width) <= max_length) {
+    ++width;
+  }
+  return width;
+}
+
+size_t CanonicalCode::min_serialized_size(size_t num_symbols) {
+  // n symbols need codes of at least ceil(log2 n) bits
+  int min_max_length = 1;
+  while ((size_t{1} << min_max_length) < num_symbols) {
+    ++min_max_length;
+  }
+  return std::min(2 + 2 * num_symbols,
+                  2 + 32 * static_cast<size_t>(packed_width(min_max_length)));
+}
+
+size_t CanonicalCode::serialized_size() const {
+  size_t num_symbols = 0;
+  for (uint8_t length : lengths_) {
+    num_symbols += length > 0;
+  }
+  return std::min(2 + 2 * num_symbols,
+                  2 + 32 * static_cast<size_t>(packed_width(max_length_)));
+}
+
+void CanonicalCode::serialize(ByteSink out) const {
+  size_t num_symbols = 0;
+  for (uint8_t length : lengths_) {
+    num_symbols += length > 0;
+  }
+
+  int width = packed_width(max_length_);
+  size_t sparse_size = 2 + 2 * num_symbols;
+  size_t packed_size = 2 + 32 * width;
+  if (sparse_size <= packed_size) {
+    out.push_back(static_cast<uint8_t>(TableFormat::kSparse));
+    out.push_back(static_cast<uint8_t>(num_symbols - 1));
+    for (size_t symbol = 0; symbol < 256; ++symbol) {
+      if (lengths_[symbol] > 0) {
+        out.push_back(static_cast<uint8_t>(symbol));
+        out.push_back(lengths_[symbol]);
+      }
+    }
+    return;
+  }
+
+  out.push_back(static_cast<uint8_t>(TableFormat::kPacked));
+  out.push_back(static_cast<uint8_t>(width));
+  // 256 * width bits is always whole bytes; pack them MSB-first in place
+  // so serializing needs no scratch writer
+  uint32_t accumulator = 0;
+  int pending_bits = 0;
+  for (uint8_t length : lengths_) {
+    accumulator = (accumulator << width) | length;
+    pending_bits += width;
+    while (pending_bits >= 8) {
+      pending_bits -= 8;
+      out.push_back(static_cast<uint8_t>(accumulator >> pending_bits));
+    }
+  }
+}
+
+size_t CanonicalCode::deserialize(const uint8_t* in, size_t size) {
+  if (size < 2) {
+    throw std::runtime_error("CanonicalCode: Truncated length table");
+  }
+
+  Lengths lengths{};
+  size_t consumed = 0;
+  switch (static_cast<TableFormat>(in[0])) {
+    case TableFormat::kSparse: {
+      size_t num_symbols = size_t{in[1]} + 1;
+      consumed = 2 + 2 * num_symbols;
+      if (consumed > size) {
+        throw std::runtime_error("CanonicalCode: Truncated length table");
+      }
+      for (size_t i = 0; i < num_symbols; ++i) {
+        lengths[in[2 + 2 * i]] = in[3 + 2 * i];
+      }
+      break;
+    }
+    case TableFormat::kPacked: {
+      int width = in[1];
+      consumed = 2 + 32 * static_cast<size_t>(width);
+      if (width < 1 || width > 7 || consumed > size) {
+        throw std::runtime_error("CanonicalCode: Corrupt length table");
+      }
+      FastBitReader reader(in + 2, consumed - 2);
+      for (auto& length : lengths) {
+        length = static_cast<uint8_t>(reader.read_bits(width));
+      }
+      break;
+    }
+    default:
+      throw std::runtime_error("CanonicalCode: Unknown length table format");
+  }
+
+  assign(lengths);
+  return consumed;
+}
@@ -0,0 +1,118 @@
+#include "core/codec_stats.hpp"
+
+#include <iomanip>
+
+namespace {
+
+double megabytes_per_second(uint64_t bytes, double seconds) {
+  return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+}  // namespace
+
+const char* CodecStats::stage_name(Stage stage) {
+  static const char* const kNames[kNumStages] = {
+      "read", "histogram", "tree", "encode", "decode", "write"};
+  return kNames[stage];
+}
+
+void CodecStats::add_stages(const CodecStats& other) {
+  for (size_t stage = 0; stage < kNumStages; ++stage) {
+    stages[stage].seconds += other.stages[stage].seconds;
+    stages[stage].bytes += other.stages[stage].bytes;
+  }
+  blocks += other.blocks;
+}
+
+double CodecStats::ratio() const {
+  return original_bytes > 0
+             ? static_cast<double>(compressed_bytes) / original_bytes
+             : 0.0;
+}
+
+double CodecStats::bits_per_symbol() const { return 8.0 * ratio(); }
+
+void CodecStats::print_text(std::ostream& out) const {
+  std::ios_base::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+
+  out << "\n=== Statistics ===\n"
+      << (compressing ? "Compressed " : "Decompressed ")
+      << (compressing ? original_bytes : compressed_bytes) << " -> "
+      << (compressing ? compressed_bytes : original_bytes) << " bytes, "
+      << blocks << " blocks, " << threads
+      << (threads == 1 ? " thread, " : " threads, ") << std::fixed
+      << std::setprecision(3) << wall_seconds << " s ("
+      << std::setprecision(1)
+      << megabytes_per_second(original_bytes, wall_seconds) << " MB/s)\n"
+      << "Ratio " << std::setprecision(3) << ratio() << ", "
+      << std::setprecision(2) << bits_per_symbol() << " bits/symbol\n"
+      << std::left << std::setw(12) << "Stage" << std::right
+      << std::setw(10) << "Time (s)" << std::setw(14) << "Bytes"
+      << std::setw(12) << "MB/s" << std::setw(8) << "Busy" << "\n";
+
+  for (size_t stage = 0; stage < kNumStages; ++stage) {
+    const StageTotal& total = stages[stage];
+    if (total.seconds == 0.0 && total.bytes == 0) {
+      continue;
+    }
+    out << std::left << std::setw(12) << stage_name(Stage(stage))
+        << std::right << std::setw(10) << std::setprecision(3)
+        << total.seconds << std::setw(14) << total.bytes << std::setw(12)
+        << std::setprecision(1)
+        << megabytes_per_second(total.bytes, total.seconds) << std::setw(7)
+        << std::setprecision(0)
+        << (wall_seconds > 0.0 ? 100.0 * total.seconds / wall_seconds : 0.0)
+        << "%\n";
+  }
+
+  // Each stage is spread over the threads that run it; whichever is
+  // busiest for its share of the wall time limits the whole run
+  const double coders = threads > 0 ? threads : 1;
+  const double io = io_threads > 0 ? io_threads : 1;
+  double coding = (stages[kHistogram].seconds + stages[kTree].seconds +
+                   stages[kEncode].seconds + stages[kDecode].seconds) /
+                  coders;
+  const char* bound = "coding (CPU)";
+  double busy = coding;
+  if (stages[kRead].seconds / io > busy) {
+    bound = "reading input (I/O)";
+    busy = stages[kRead].seconds / io;
+  }
+  if (stages[kWrite].seconds / io > busy) {
+    bound = "writing output (I/O)";
+    busy = stages[kWrite].seconds / io;
+  }
+  if (wall_seconds > 0.0) {
+    out << "Bound by " << bound << ", busy " << std::setprecision(0)
+        << 100.0 * busy / wall_seconds << "% of the wall time\n";
+  }
+
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void CodecStats::print_json(std::ostream& out) const {
+  std::ios_base::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+
+  out << std::fixed << "{\"mode\": \""
+      << (compressing ? "compress" : "decompress") << "\""
+      << ", \"threads\": " << threads << ", \"io_threads\": " << io_threads
+      << ", \"original_bytes\": " << original_bytes
+      << ", \"compressed_bytes\": " << compressed_bytes
+      << ", \"blocks\": " << blocks << ", \"wall_seconds\": "
+      << std::setprecision(6) << wall_seconds << ", \"ratio\": "
+      << std::setprecision(4) << ratio() << ", \"bits_per_symbol\": "
+      << bits_per_symbol() << ", \"stages\": {";
+  for (size_t stage = 0; stage < kNumStages; ++stage) {
+    out << (stage ? ", " : "") << "\"" << stage_name(Stage(stage))
+        << "\": {\"seconds\": " << std::setprecision(6)
+        << stages[stage].seconds << ", \"bytes\": " << stages[stage].bytes
+        << "}";
+  }
+  out << "}}\n";
+
+  out.flags(flags);
+  out.precision(precision);
+}
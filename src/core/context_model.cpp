@@ -0,0 +1,213 @@
+#include "core/context_model.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+using Histogram = ContextModel::Histogram;
+using BitCosts = std::array<double, 256>;
+
+// Pseudo-count for symbols a cluster has not seen, so that any context can
+// be priced against any cluster
+constexpr double kSmoothing = 0.5;
+constexpr int kRefinePasses = 6;
+
+uint64_t total_count(const Histogram& histogram) {
+  uint64_t total = 0;
+  for (uint64_t count : histogram) {
+    total += count;
+  }
+  return total;
+}
+
+// Ideal code length of every symbol under histogram's statistics
+void bit_costs(const Histogram& histogram, BitCosts& costs) {
+  double log_total =
+      std::log2(static_cast<double>(total_count(histogram)) + 256 * kSmoothing);
+  for (size_t symbol = 0; symbol < 256; ++symbol) {
+    costs[symbol] = log_total - std::log2(histogram[symbol] + kSmoothing);
+  }
+}
+
+double coded_bits(const Histogram& histogram, const BitCosts& costs) {
+  double bits = 0.0;
+  for (size_t symbol = 0; symbol < 256; ++symbol) {
+    if (histogram[symbol] > 0) {
+      bits += histogram[symbol] * costs[symbol];
+    }
+  }
+  return bits;
+}
+
+}  // namespace
+
+void ContextModel::count(const uint8_t* data, size_t size) {
+  histograms_.assign(256, Histogram{});
+
+  Histogram* histograms = histograms_.data();
+  uint8_t previous = 0;
+  for (size_t i = 0; i < size; ++i) {
+    histograms[previous][data[i]]++;
+    previous = data[i];
+  }
+}
+
+ContextModel::Histogram ContextModel::order0() const {
+  Histogram sum{};
+  for (const Histogram& histogram : histograms_) {
+    for (size_t symbol = 0; symbol < 256; ++symbol) {
+      sum[symbol] += histogram[symbol];
+    }
+  }
+  return sum;
+}
+
+double ContextModel::conditional_entropy_bits() const {
+  double bits = 0.0;
+  for (const Histogram& histogram : histograms_) {
+    bits += FrequencyAnalyzer::entropy_bits(histogram);
+  }
+  return bits;
+}
+
+size_t ContextModel::cluster(size_t max_clusters, ContextMap& map,
+                             std::vector<Histogram>& clusters) const {
+  if (max_clusters == 0 || max_clusters > kMaxClusters) {
+    throw std::invalid_argument("ContextModel: Invalid cluster count");
+  }
+  map.fill(0);
+  clusters.clear();
+
+  // Contexts that occur, heaviest first
+  std::vector<uint8_t> active;
+  std::array<uint64_t, 256> totals{};
+  for (size_t context = 0; context < histograms_.size(); ++context) {
+    totals[context] = total_count(histograms_[context]);
+    if (totals[context] > 0) {
+      active.push_back(static_cast<uint8_t>(context));
+    }
+  }
+  std::stable_sort(active.begin(), active.end(), [&](uint8_t a, uint8_t b) {
+    return totals[a] > totals[b];
+  });
+
+  if (active.size() <= max_clusters) {
+    for (uint8_t context : active) {
+      map[context] = static_cast<uint8_t>(clusters.size());
+      clusters.push_back(histograms_[context]);
+    }
+    return clusters.size();
+  }
+
+  // Seed with the heaviest context, then keep adding the context that the
+  // seeds so far code worst compared with its own statistics
+  std::array<double, 256> own_bits{};
+  std::array<double, 256> best_bits{};
+  BitCosts costs;
+  for (uint8_t context : active) {
+    bit_costs(histograms_[context], costs);
+    own_bits[context] = coded_bits(histograms_[context], costs);
+  }
+
+  std::vector<BitCosts> cluster_costs;
+  uint8_t seed = active[0];
+  for (;;) {
+    cluster_costs.emplace_back();
+    bit_costs(histograms_[seed], cluster_costs.back());
+    for (uint8_t context : active) {
+      double bits = coded_bits(histograms_[context], cluster_costs.back());
+      if (cluster_costs.size() == 1 || bits < best_bits[context]) {
+        best_bits[context] = bits;
+      }
+    }
+    if (cluster_costs.size() == max_clusters) {
+      break;
+    }
+
+    double worst_waste = 1.0;  // contexts within a bit of optimal are done
+    bool found = false;
+    for (uint8_t context : active) {
+      double waste = best_bits[context] - own_bits[context];
+      if (waste > worst_waste) {
+        worst_waste = waste;
+        seed = context;
+        found = true;
+      }
+    }
+    if (!found) {
+      break;
+    }
+  }
+
+  // Refine: move every context to its cheapest cluster and re-derive the
+  // cluster statistics until nothing moves
+  ContextMap assignment{};
+  for (int pass = 0; pass < kRefinePasses; ++pass) {
+    bool changed = pass == 0;
+    for (uint8_t context : active) {
+      size_t best = 0;
+      double best_cost = 0.0;
+      for (size_t c = 0; c < cluster_costs.size(); ++c) {
+        double bits = coded_bits(histograms_[context], cluster_costs[c]);
+        if (c == 0 || bits < best_cost) {
+          best = c;
+          best_cost = bits;
+        }
+      }
+      changed |= assignment[context] != best;
+      assignment[context] = static_cast<uint8_t>(best);
+    }
+
+    // Clusters that lost all their contexts are dropped
+    std::vector<Histogram> sums(cluster_costs.size(), Histogram{});
+    for (uint8_t context : active) {
+      Histogram& sum = sums[assignment[context]];
+      for (size_t symbol = 0; symbol < 256; ++symbol) {
+        sum[symbol] += histograms_[context][symbol];
+      }
+    }
+    std::array<uint8_t, kMaxClusters> renumber{};
+    clusters.clear();
+    for (size_t c = 0; c < sums.size(); ++c) {
+      if (total_count(sums[c]) > 0) {
+        renumber[c] = static_cast<uint8_t>(clusters.size());
+        clusters.push_back(sums[c]);
+      }
+    }
+    for (uint8_t context : active) {
+      assignment[context] = renumber[assignment[context]];
+    }
+
+    if (!changed) {
+      break;
+    }
+    cluster_costs.resize(clusters.size());
+    for (size_t c = 0; c < clusters.size(); ++c) {
+      bit_costs(clusters[c], cluster_costs[c]);
+    }
+  }
+
+  for (uint8_t context : active) {
+    map[context] = assignment[context];
+  }
+  return clusters.size();
+}
+
+void ContextModel::serialize_map(const ContextMap& map, ByteSink out) {
+  for (size_t context = 0; context < 256; context += 2) {
+    out.push_back(static_cast<uint8_t>((map[context] << 4) | map[context + 1]));
+  }
+}
+
+void ContextModel::deserialize_map(const uint8_t* in, size_t num_clusters,
+                                   ContextMap& map) {
+  for (size_t context = 0; context < 256; context += 2) {
+    map[context] = in[context / 2] >> 4;
+    map[context + 1] = in[context / 2] & 0x0F;
+    if (map[context] >= num_clusters || map[context + 1] >= num_clusters) {
+      throw std::runtime_error("ContextModel: Corrupt context map");
+    }
+  }
+}
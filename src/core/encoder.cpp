@@ -1,52 +1,128 @@
 #include "core/encoder.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
-#include "indicators/progress_bar.hpp"
+#include "core/container_format.hpp"
+#include "core/input_source.hpp"
+#include "core/thread_pool.hpp"
 
-void Encoder::write_header(std::ofstream& output,
-                           const std::map<uint8_t, uint64_t>& frequencies) {
-  if (!output.is_open()) {
-    throw std::runtime_error("Output file is not open");
+namespace {
+
+// "-" selects standard output; anything else is (re)created as a file
+std::ostream& open_output(const std::string& output_file, std::ofstream& file) {
+  if (is_standard_stream(output_file)) {
+    return std::cout;
+  }
+  file.open(output_file, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Could not open output file: " + output_file);
   }
+  return file;
+}
 
-  // Write the number of unique characters
-  uint32_t num_unique_chars = static_cast<uint32_t>(frequencies.size());
-  output.write(reinterpret_cast<const char*>(&num_unique_chars),
-               sizeof(num_unique_chars));
+}  // namespace
 
-  // Write each character and its frequency
-  for (const auto& pair : frequencies) {
-    output.write(reinterpret_cast<const char*>(&pair.first),
-                 sizeof(pair.first));
-    output.write(reinterpret_cast<const char*>(&pair.second),
-                 sizeof(pair.second));
+void Encoder::set_buffer_size(size_t bytes) {
+  if (bytes == 0) {
+    throw std::invalid_argument("Buffer size must be greater than zero");
   }
+  buffer_size_ = bytes;
 }
 
-std::map<uint8_t, uint64_t> Encoder::read_header(std::ifstream& input) {
-  if (!input.is_open()) {
-    throw std::runtime_error("Input file is not open");
+void Encoder::set_block_size(size_t bytes) {
+  if (bytes == 0 || bytes > kMaxBlockSize) {
+    throw std::invalid_argument("Block size must be between 1 byte and " +
+                                std::to_string(kMaxBlockSize) + " bytes");
   }
+  block_size_ = bytes;
+}
 
-  std::map<uint8_t, uint64_t> frequencies;
+void Encoder::set_num_threads(int num_threads) {
+  if (num_threads < 1) {
+    throw std::invalid_argument("Number of threads must be at least 1");
+  }
+  num_threads_ = num_threads;
+}
 
-  // Read the number of unique characters
-  uint32_t num_unique_chars;
-  input.read(reinterpret_cast<char*>(&num_unique_chars),
-             sizeof(num_unique_chars));
+void Encoder::set_max_code_length(int bits) {
+  if (bits != 0 && (bits < 8 || bits > CanonicalCode::kMaxCodeLength)) {
+    throw std::invalid_argument(
+        "Maximum code length must be 0 or between 8 and 64 bits");
+  }
+  max_code_length_ = bits;
+}
+
+void Encoder::set_shared_table(std::shared_ptr<const SharedTable> table) {
+  shared_table_ = std::move(table);
+}
+
+BlockPipeline& Encoder::ensure_pipeline(size_t num_coders) {
+  if (!pipeline_ || pipeline_->num_coders() != num_coders) {
+    pipeline_ = std::make_unique<BlockPipeline>(num_coders);
+  }
+  return *pipeline_;
+}
+
+void Encoder::ensure_block_codecs(size_t count) {
+  while (block_codecs_.size() < count) {
+    block_codecs_.push_back(std::make_unique<BlockCodec>());
+  }
+  for (auto& codec : block_codecs_) {
+    codec->set_max_code_length(max_code_length_);
+    codec->set_shared_table(shared_table_.get());
+    codec->set_context_mode(context_mode_);
+    codec->set_collect_stats(collect_stats_);
+  }
+}
+
+void Encoder::start_stats(bool compressing) {
+  stats_ = CodecStats();
+  stats_.compressing = compressing;
+  stats_.threads = num_threads_;
+  stats_start_ = std::chrono::steady_clock::now();
+  for (auto& codec : block_codecs_) {
+    codec->reset_stats();
+  }
+}
+
+void Encoder::finish_stats() {
+  for (auto& codec : block_codecs_) {
+    stats_.add_stages(codec->stats());
+  }
+  stats_.wall_seconds = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - stats_start_)
+                            .count();
+}
+
+std::map<uint8_t, uint64_t> Encoder::read_header(std::istream& input,
+                                                 uint32_t num_unique_chars) {
+  std::map<uint8_t, uint64_t> frequencies;
 
   // Read each character and its frequency
   for (uint32_t i = 0; i < num_unique_chars; ++i) {
-    uint8_t byte;
-    uint64_t frequency;
+    uint8_t byte = 0;
+    uint64_t frequency = 0;
     input.read(reinterpret_cast<char*>(&byte), sizeof(byte));
+    if (input.gcount() != sizeof(byte)) {
+      throw std::runtime_error("Truncated legacy header");
+    }
     input.read(reinterpret_cast<char*>(&frequency), sizeof(frequency));
+    if (input.gcount() != sizeof(frequency)) {
+      throw std::runtime_error("Truncated legacy header");
+    }
     frequencies[byte] = frequency;
   }
 
@@ -55,133 +131,589 @@ std::map<uint8_t, uint64_t> Encoder::read_header(std::ifstream& input) {
 
 void Encoder::compress(const std::string& input_file,
                        const std::string& output_file) {
-  // 1. Analyze frequencies
-  auto frequencies = frequency_analyzer_.analyze_file(input_file);
-  if (frequencies.empty()) {
-    // Handle empty file: create an empty output file.
-    std::ofstream output(output_file, std::ios::binary);
-    output.close();
+  start_stats(true);
+
+  // 1. Open files; regular inputs are memory-mapped, standard input is
+  // read block by block as it arrives
+  InputSource input(input_file);
+  std::ofstream file;
+  std::ostream& output = open_output(output_file, file);
+
+  uint64_t file_size = input.size();
+
+  // 2. Write the container header
+  std::vector<uint8_t> file_header;
+  // A single block has nothing to index
+  FileHeader header;
+  if (!input.size_known() || file_size > block_size_) {
+    header.flags = kFlagBlockIndex;
+  }
+  header.block_size = static_cast<uint32_t>(block_size_);
+  append_file_header(file_header, header);
+  output.write(reinterpret_cast<const char*>(file_header.data()),
+               file_header.size());
+
+  // Progress goes to standard error, keeping standard output for data;
+  // the sampler thread draws it, the writer only counts
+  ProgressReporter progress(ProgressReporter::Kind::kCompress, file_size,
+                            progress_enabled());
+
+  // 3. Read, code and write on separate threads so they overlap; the
+  // writer gets the blocks back in input order
+  const size_t num_coders = static_cast<size_t>(num_threads_);
+  ensure_block_codecs(num_coders);
+
+  // Where each block landed, written out as the index at the end
+  std::vector<BlockIndexEntry> block_index;
+  uint64_t output_offset = file_header.size();
+
+  size_t processed_bytes = 0;
+  bool input_done = false;
+  ensure_pipeline(num_coders).run(
+      [&](BlockPipeline::Slot& slot) {
+        if (input_done) {
+          return false;
+        }
+        StageClock clock(stage_stats());
+        slot.span = input.read(block_size_, slot.input);
+        clock.lap(CodecStats::kRead, slot.span.size);
+        input_done = slot.span.size < block_size_;
+        return slot.span.size > 0;
+      },
+      [this](BlockPipeline::Slot& slot, size_t coder) {
+        slot.output.clear();
+        block_codecs_[coder]->encode_block(slot.span.data, slot.span.size,
+                                           slot.output);
+      },
+      [&](BlockPipeline::Slot& slot) {
+        StageClock clock(stage_stats());
+        output.write(reinterpret_cast<const char*>(slot.output.data()),
+                     slot.output.size());
+        clock.lap(CodecStats::kWrite, slot.output.size());
+
+        BlockIndexEntry entry;
+        entry.offset = output_offset;
+        entry.stored_size = static_cast<uint32_t>(slot.output.size());
+        entry.original_size = static_cast<uint32_t>(slot.span.size);
+        block_index.push_back(entry);
+
+        output_offset += slot.output.size();
+        processed_bytes += slot.span.size;
+        input.release(slot.span);
+        progress.add(slot.span.size);
+      });
+
+  // 4. Terminate the block sequence and append the block index
+  std::vector<uint8_t> trailer;
+  append_block_header(trailer, BlockHeader{});
+  if (header.flags & kFlagBlockIndex) {
+    append_block_index(trailer, block_index, output_offset + trailer.size());
+  }
+  StageClock clock(stage_stats());
+  output.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+  output.flush();
+  clock.lap(CodecStats::kWrite, trailer.size());
+  progress.finish();
+
+  if (!output) {
+    throw std::runtime_error("Failed to write output file: " + output_file);
+  }
+
+  stats_.original_bytes = processed_bytes;
+  stats_.compressed_bytes = output_offset + trailer.size();
+  finish_stats();
+}
+
+void Encoder::decompress(const std::string& input_file,
+                         const std::string& output_file) {
+  start_stats(false);
+
+  // Files report their size; standard input is decoded as it arrives
+  std::ifstream file;
+  std::istream* input = &std::cin;
+  size_t file_size = 0;
+  const bool seekable = !is_standard_stream(input_file);
+  if (seekable) {
+    file.open(input_file, std::ios::binary);
+    if (!file.is_open()) {
+      throw std::runtime_error("Could not open input file: " + input_file);
+    }
+    file.seekg(0, std::ios::end);
+    file_size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    input = &file;
+  }
+
+  // Container files start with the magic, anything else is legacy
+  uint8_t magic[4] = {0, 0, 0, 0};
+  input->read(reinterpret_cast<char*>(magic), sizeof(magic));
+  size_t magic_size = static_cast<size_t>(input->gcount());
+  bool is_container =
+      magic_size == sizeof(magic) && has_container_magic(magic);
+
+  // Legacy files open with their native-endian symbol count instead
+  uint32_t num_unique_chars = 0;
+  if (!is_container && magic_size > 0) {
+    if (magic_size != sizeof(magic)) {
+      throw std::runtime_error("Truncated input file");
+    }
+    std::memcpy(&num_unique_chars, magic, sizeof(num_unique_chars));
+    if (num_unique_chars == 0 || num_unique_chars > 256) {
+      throw std::runtime_error("Not a .qcmp file");
+    }
+  }
+
+  FileHeader header;
+  if (is_container) {
+    uint8_t header_bytes[kFileHeaderSize - 4];
+    input->read(reinterpret_cast<char*>(header_bytes), sizeof(header_bytes));
+    if (input->gcount() != sizeof(header_bytes)) {
+      throw std::runtime_error("Truncated container header");
+    }
+    header = load_file_header(header_bytes);
+    if (header.version != kContainerVersion) {
+      throw std::runtime_error("Unsupported container version: " +
+                               std::to_string(header.version));
+    }
+    if (header.block_size == 0 || header.block_size > kMaxBlockSize) {
+      throw std::runtime_error("Corrupt container header");
+    }
+
+    // With an index, blocks are decoded concurrently straight into place;
+    // that needs random access to both files
+    if ((header.flags & kFlagBlockIndex) && num_threads_ > 1 && seekable &&
+        !is_standard_stream(output_file)) {
+      auto block_index = read_block_index(file, file_size, header);
+      decompress_indexed(input_file, output_file, block_index, file_size);
+      finish_stats();
+      return;
+    }
+  }
+
+  std::ofstream output_file_stream;
+  std::ostream& output = open_output(output_file, output_file_stream);
+
+  // An empty file decompresses to an empty file
+  if (magic_size == 0) {
+    finish_stats();
     return;
   }
 
-  // 2. Build Huffman tree
-  huffman_tree_.build_tree(frequencies);
-  auto codes = huffman_tree_.generate_codes();
+  if (is_container) {
+    decompress_blocks(*input, output, header, file_size);
+  } else {
+    decompress_legacy(*input, output, num_unique_chars);
+  }
 
-  // 3. Open files
-  std::ifstream input(input_file, std::ios::binary);
-  if (!input.is_open()) {
-    throw std::runtime_error("Could not open input file: " + input_file);
+  output.flush();
+  if (!output) {
+    throw std::runtime_error("Failed to write output file: " + output_file);
   }
+  finish_stats();
+}
 
-  std::ofstream output(output_file, std::ios::binary);
-  if (!output.is_open()) {
-    throw std::runtime_error("Could not open output file: " + output_file);
+std::vector<BlockIndexEntry> Encoder::read_block_index(
+    std::ifstream& input, size_t file_size, const FileHeader& header) {
+  uint32_t num_blocks = 0;
+  uint64_t index_offset = locate_block_index(input, file_size, num_blocks);
+  return read_index_entries(input, index_offset, 0, num_blocks, header);
+}
+
+uint64_t Encoder::locate_block_index(std::ifstream& input, size_t file_size,
+                                     uint32_t& num_blocks) {
+  if (file_size < kFileHeaderSize + 4 + kIndexTrailerSize) {
+    throw std::runtime_error("Truncated block index");
+  }
+
+  uint8_t trailer[kIndexTrailerSize];
+  input.seekg(file_size - kIndexTrailerSize, std::ios::beg);
+  input.read(reinterpret_cast<char*>(trailer), sizeof(trailer));
+  if (input.gcount() != sizeof(trailer) ||
+      !std::equal(kIndexMagic, kIndexMagic + 4, trailer + 8)) {
+    throw std::runtime_error("Missing block index trailer");
+  }
+
+  uint64_t index_offset = load_u64(trailer);
+  if (index_offset < kFileHeaderSize ||
+      index_offset > file_size - kIndexTrailerSize - 4) {
+    throw std::runtime_error("Corrupt block index offset");
+  }
+
+  uint8_t count_bytes[4];
+  input.seekg(index_offset, std::ios::beg);
+  input.read(reinterpret_cast<char*>(count_bytes), sizeof(count_bytes));
+  num_blocks = load_u32(count_bytes);
+  if (input.gcount() != sizeof(count_bytes) ||
+      file_size - kIndexTrailerSize - index_offset !=
+          4 + uint64_t{num_blocks} * BlockIndexEntry::kSize) {
+    throw std::runtime_error("Corrupt block index size");
+  }
+  return index_offset;
+}
+
+std::vector<BlockIndexEntry> Encoder::read_index_entries(
+    std::ifstream& input, uint64_t index_offset, uint64_t first, size_t count,
+    const FileHeader& header) {
+  std::vector<uint8_t> index_bytes(count * BlockIndexEntry::kSize);
+  input.seekg(block_index_entry_offset(index_offset, first), std::ios::beg);
+  input.read(reinterpret_cast<char*>(index_bytes.data()), index_bytes.size());
+  if (static_cast<size_t>(input.gcount()) != index_bytes.size()) {
+    throw std::runtime_error("Truncated block index");
+  }
+
+  std::vector<BlockIndexEntry> entries(count);
+  for (size_t i = 0; i < count; ++i) {
+    entries[i] =
+        load_block_index_entry(index_bytes.data() + i * BlockIndexEntry::kSize);
+    const auto& entry = entries[i];
+    if (entry.offset < kFileHeaderSize ||
+        entry.stored_size < BlockHeader::kSize ||
+        entry.offset + entry.stored_size > index_offset ||
+        entry.original_size == 0 || entry.original_size > header.block_size) {
+      throw std::runtime_error("Corrupt block index entry " +
+                               std::to_string(first + i));
+    }
   }
+  return entries;
+}
 
-  // 4. Write header
-  write_header(output, frequencies);
+uint64_t Encoder::decompress_range(const std::string& input_file,
+                                   const std::string& output_file,
+                                   uint64_t offset, uint64_t length) {
+  start_stats(false);
+  stats_.threads = 1;
 
-  // 5. Read and compress file byte by byte
+  // Blocks are found through the index, which needs random access
+  if (is_standard_stream(input_file)) {
+    throw std::runtime_error("Range decompression needs an input file");
+  }
+  std::ifstream input(input_file, std::ios::binary);
+  if (!input.is_open()) {
+    throw std::runtime_error("Could not open input file: " + input_file);
+  }
   input.seekg(0, std::ios::end);
   size_t file_size = input.tellg();
   input.seekg(0, std::ios::beg);
 
-  indicators::ProgressBar bar{
-      indicators::option::BarWidth{50},
-      indicators::option::Start{"["},
-      indicators::option::Fill{"="},
-      indicators::option::Lead{">"},
-      indicators::option::Remainder{" "},
-      indicators::option::End{"]"},
-      indicators::option::PostfixText{"Compressing file"},
-      indicators::option::ForegroundColor{indicators::Color::green},
-      indicators::option::FontStyles{
-          std::vector<indicators::FontStyle>{indicators::FontStyle::bold}}};
-
-  bit_stream_.clear();
-  size_t processed_bytes = 0;
+  uint8_t header_bytes[kFileHeaderSize];
+  input.read(reinterpret_cast<char*>(header_bytes), sizeof(header_bytes));
+  if (input.gcount() != sizeof(header_bytes) ||
+      !has_container_magic(header_bytes)) {
+    throw std::runtime_error("Range decompression needs a .qcmp container");
+  }
+  FileHeader header = load_file_header(header_bytes + 4);
+  if (header.version != kContainerVersion) {
+    throw std::runtime_error("Unsupported container version: " +
+                             std::to_string(header.version));
+  }
+  if (header.block_size == 0 || header.block_size > kMaxBlockSize) {
+    throw std::runtime_error("Corrupt container header");
+  }
 
-  char byte;
-  while (input.get(byte)) {
-    uint8_t ubyte = static_cast<uint8_t>(byte);
-    auto it = codes.find(ubyte);
-    if (it != codes.end()) {
-      const std::string& code = it->second;
-      for (char c : code) {
-        bit_stream_.write_bit(c == '1');
+  // Blocks holding the first and the last byte of the range
+  const uint64_t end =
+      length > UINT64_MAX - offset ? UINT64_MAX : offset + length;
+  const uint64_t first_block = offset / header.block_size;
+  uint64_t last_block = length > 0 ? (end - 1) / header.block_size : 0;
+
+  std::vector<BlockIndexEntry> entries;
+  uint64_t num_blocks = 0;
+  if (header.flags & kFlagBlockIndex) {
+    uint32_t count = 0;
+    uint64_t index_offset = locate_block_index(input, file_size, count);
+    num_blocks = count;
+    if (length > 0 && first_block < num_blocks) {
+      last_block = std::min<uint64_t>(last_block, num_blocks - 1);
+      entries = read_index_entries(input, index_offset, first_block,
+                                   last_block - first_block + 1, header);
+    }
+  } else {
+    // Without an index there is at most one block, right after the header
+    uint8_t block_header_bytes[BlockHeader::kSize];
+    input.read(reinterpret_cast<char*>(block_header_bytes),
+               sizeof(block_header_bytes));
+    if (input.gcount() != sizeof(block_header_bytes)) {
+      throw std::runtime_error("Truncated block header");
+    }
+    BlockHeader block_header = load_block_header(block_header_bytes);
+    if (block_header.original_size > 0) {
+      num_blocks = 1;
+      BlockIndexEntry entry;
+      entry.offset = kFileHeaderSize;
+      entry.stored_size = BlockHeader::kSize + block_header.compressed_size;
+      entry.original_size = block_header.original_size;
+      if (length > 0 && first_block == 0) {
+        entries.push_back(entry);
       }
-    } else {
-      throw std::runtime_error("Byte not found in Huffman codes: " +
-                               std::to_string(ubyte));
     }
+  }
 
-    processed_bytes++;
-    if (processed_bytes % 1000 == 0) {
-      bar.set_progress((processed_bytes * 100) / file_size);
+  std::ofstream output_file_stream;
+  std::ostream& output = open_output(output_file, output_file_stream);
+
+  ensure_block_codecs(1);
+  std::vector<uint8_t> stored;
+  std::vector<uint8_t> decoded;
+  uint64_t written = 0;
+  StageClock clock(stage_stats());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const uint64_t block = first_block + i;
+    const auto& entry = entries[i];
+    // A short block before the last would shift every later offset
+    if (block + 1 < num_blocks && entry.original_size != header.block_size) {
+      throw std::runtime_error("Block " + std::to_string(block) +
+                               " is short, the file is not seekable");
     }
-  }
 
-  bar.set_progress(100);
+    clock.restart();
+    stored.resize(entry.stored_size);
+    input.seekg(entry.offset, std::ios::beg);
+    input.read(reinterpret_cast<char*>(stored.data()), stored.size());
+    if (static_cast<size_t>(input.gcount()) != stored.size()) {
+      throw std::runtime_error("Truncated block " + std::to_string(block));
+    }
+    clock.lap(CodecStats::kRead, stored.size());
+    stats_.compressed_bytes += stored.size();
+
+    BlockHeader block_header = load_block_header(stored.data());
+    if (block_header.original_size != entry.original_size ||
+        block_header.compressed_size + BlockHeader::kSize !=
+            entry.stored_size) {
+      throw std::runtime_error("Block " + std::to_string(block) +
+                               " does not match the index");
+    }
+
+    decoded.resize(block_header.original_size);
+    try {
+      block_codecs_[0]->decode_block(
+          block_header, stored.data() + BlockHeader::kSize, decoded.data());
+    } catch (const std::runtime_error& e) {
+      throw std::runtime_error("Failed to decompress file: " +
+                               std::string(e.what()));
+    }
 
-  // 6. Write compressed data
-  auto compressed_data = bit_stream_.get_buffer();
-  output.write(reinterpret_cast<const char*>(compressed_data.data()),
-               compressed_data.size());
+    // Part of the block inside the range
+    const uint64_t block_start = block * header.block_size;
+    size_t from = static_cast<size_t>(std::max(offset, block_start) -
+                                      block_start);
+    size_t to = static_cast<size_t>(
+        std::min<uint64_t>(entry.original_size, end - block_start));
+    if (to > from) {
+      clock.restart();
+      output.write(reinterpret_cast<const char*>(decoded.data() + from),
+                   to - from);
+      clock.lap(CodecStats::kWrite, to - from);
+      written += to - from;
+    }
+  }
+
+  output.flush();
+  if (!output) {
+    throw std::runtime_error("Failed to write output file: " + output_file);
+  }
+  // Ratio of the blocks read, not the whole file
+  stats_.original_bytes = written;
+  finish_stats();
+  return written;
 }
 
-void Encoder::decompress(const std::string& input_file,
-                         const std::string& output_file) {
-  std::ifstream input(input_file, std::ios::binary);
-  if (!input.is_open()) {
-    throw std::runtime_error("Could not open input file: " + input_file);
+void Encoder::decompress_indexed(
+    const std::string& input_file, const std::string& output_file,
+    const std::vector<BlockIndexEntry>& block_index, size_t file_size) {
+  // Output position of every block from the running sum of sizes
+  std::vector<uint64_t> output_offsets(block_index.size());
+  uint64_t total_size = 0;
+  for (size_t i = 0; i < block_index.size(); ++i) {
+    output_offsets[i] = total_size;
+    total_size += block_index[i].original_size;
   }
 
-  // Check if the file is empty
-  input.seekg(0, std::ios::end);
-  if (input.tellg() == 0) {
-    std::ofstream output(output_file, std::ios::binary);
-    output.close();
-    return;
+  // Create the output at its final size so workers can write anywhere
+  {
+    std::ofstream output(output_file, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+      throw std::runtime_error("Could not open output file: " + output_file);
+    }
+    if (total_size > 0) {
+      output.seekp(total_size - 1);
+      output.put('\0');
+    }
+    if (!output) {
+      throw std::runtime_error("Failed to write output file: " + output_file);
+    }
   }
-  input.seekg(0, std::ios::beg);
 
-  // 1. Read header and build Huffman tree
-  auto frequencies = read_header(input);
-  huffman_tree_.build_tree(frequencies);
+  ProgressReporter progress(ProgressReporter::Kind::kDecompress, total_size,
+                            progress_enabled());
+
+  // Each worker pulls the next block number until all are claimed
+  const size_t num_workers = static_cast<size_t>(num_threads_);
+  ensure_block_codecs(num_workers);
+  std::atomic<size_t> next_block{0};
+  // Read and write times per worker, summed once they are done
+  std::vector<CodecStats> worker_stats(num_workers);
+
+  auto worker = [&](size_t worker_id) {
+    StageClock clock(collect_stats_ ? &worker_stats[worker_id] : nullptr);
+    std::ifstream input(input_file, std::ios::binary);
+    std::fstream output(output_file,
+                        std::ios::binary | std::ios::in | std::ios::out);
+    if (!input.is_open() || !output.is_open()) {
+      throw std::runtime_error("Could not reopen files for decompression");
+    }
 
-  // 2. Read compressed data
-  std::vector<uint8_t> compressed_data;
-  size_t current_pos = input.tellg();
-  input.seekg(0, std::ios::end);
-  size_t end_pos = input.tellg();
-  input.seekg(current_pos, std::ios::beg);
+    std::vector<uint8_t> stored;
+    std::vector<uint8_t> decoded;
+    try {
+      for (size_t i = next_block++; i < block_index.size(); i = next_block++) {
+        const auto& entry = block_index[i];
+        clock.restart();
+        stored.resize(entry.stored_size);
+        input.seekg(entry.offset, std::ios::beg);
+        input.read(reinterpret_cast<char*>(stored.data()), stored.size());
+        if (static_cast<size_t>(input.gcount()) != stored.size()) {
+          throw std::runtime_error("Truncated block " + std::to_string(i));
+        }
+        clock.lap(CodecStats::kRead, stored.size());
+
+        BlockHeader block_header = load_block_header(stored.data());
+        if (block_header.original_size != entry.original_size ||
+            block_header.compressed_size + BlockHeader::kSize !=
+                entry.stored_size) {
+          throw std::runtime_error("Block " + std::to_string(i) +
+                                   " does not match the index");
+        }
+
+        decoded.resize(block_header.original_size);
+        block_codecs_[worker_id]->decode_block(
+            block_header, stored.data() + BlockHeader::kSize, decoded.data());
+
+        clock.restart();
+        output.seekp(output_offsets[i], std::ios::beg);
+        output.write(reinterpret_cast<const char*>(decoded.data()),
+                     decoded.size());
+        clock.lap(CodecStats::kWrite, decoded.size());
+        progress.add(decoded.size());
+      }
+    } catch (...) {
+      next_block = block_index.size();  // Stop the other workers early
+      throw;
+    }
 
-  compressed_data.resize(end_pos - current_pos);
-  input.read(reinterpret_cast<char*>(compressed_data.data()),
-             compressed_data.size());
-  input.close();
+    // Close here so a failed final write-back is not lost in the destructor
+    output.close();
+    if (!output) {
+      throw std::runtime_error("Failed to write output file: " + output_file);
+    }
+  };
 
-  // 3. Decompress data
-  std::ofstream output(output_file, std::ios::binary);
-  if (!output.is_open()) {
-    throw std::runtime_error("Could not open output file: " + output_file);
+  ThreadPool pool(num_workers);
+  std::vector<std::future<void>> workers;
+  for (size_t i = 0; i < num_workers; ++i) {
+    workers.push_back(pool.submit([&worker, i] { worker(i); }));
   }
 
-  bit_stream_.clear();
-  bit_stream_.load_from_buffer(compressed_data);
+  try {
+    // Every worker must be done with the buffers before any error unwinds
+    for (auto& result : workers) {
+      result.wait();
+    }
+    for (auto& result : workers) {
+      result.get();
+    }
+  } catch (const std::runtime_error& e) {
+    throw std::runtime_error("Failed to decompress file: " +
+                             std::string(e.what()));
+  }
+
+  progress.finish();
 
-  indicators::ProgressBar bar{
-      indicators::option::BarWidth{50},
-      indicators::option::Start{"["},
-      indicators::option::Fill{"="},
-      indicators::option::Lead{">"},
-      indicators::option::Remainder{" "},
-      indicators::option::End{"]"},
-      indicators::option::PostfixText{"Decompressing file"},
-      indicators::option::ForegroundColor{indicators::Color::yellow},
-      indicators::option::FontStyles{
-          std::vector<indicators::FontStyle>{indicators::FontStyle::bold}}};
+  for (const auto& stats : worker_stats) {
+    stats_.add_stages(stats);
+  }
+  stats_.io_threads = static_cast<int>(num_workers);
+  stats_.original_bytes = total_size;
+  stats_.compressed_bytes = file_size;
+}
+
+void Encoder::decompress_blocks(std::istream& input, std::ostream& output,
+                                const FileHeader& header, size_t file_size) {
+  // Progress follows the compressed bytes consumed, the only size known
+  ProgressReporter progress(ProgressReporter::Kind::kDecompress, file_size,
+                            progress_enabled());
+  progress.add(kFileHeaderSize);
+
+  // Blocks are read, decoded and written on separate threads, in order
+  const size_t num_coders = static_cast<size_t>(num_threads_);
+  ensure_block_codecs(num_coders);
+
+  // Counted here rather than asked of the stream, which pipes cannot answer
+  size_t read_position = kFileHeaderSize;
+  const size_t max_body = header.block_size + kMaxBlockOverhead;
+  ensure_pipeline(num_coders).run(
+      [&](BlockPipeline::Slot& slot) {
+        StageClock clock(stage_stats());
+        uint8_t block_header_bytes[BlockHeader::kSize];
+        input.read(reinterpret_cast<char*>(block_header_bytes),
+                   sizeof(block_header_bytes));
+        if (input.gcount() != sizeof(block_header_bytes)) {
+          throw std::runtime_error("Truncated block header");
+        }
+        read_position += BlockHeader::kSize;
+
+        slot.header = load_block_header(block_header_bytes);
+        if (slot.header.original_size == 0) {
+          return false;
+        }
+
+        // Standard input has no size to check against, but no block of
+        // block_size bytes needs a body larger than max_body
+        if (slot.header.original_size > header.block_size ||
+            slot.header.compressed_size > max_body ||
+            (file_size > 0 &&
+             slot.header.compressed_size > file_size - read_position)) {
+          throw std::runtime_error("Corrupt block header");
+        }
+
+        slot.input.resize(slot.header.compressed_size);
+        input.read(reinterpret_cast<char*>(slot.input.data()),
+                   slot.input.size());
+        if (static_cast<size_t>(input.gcount()) != slot.input.size()) {
+          throw std::runtime_error("Truncated block");
+        }
+        read_position += slot.input.size();
+        clock.lap(CodecStats::kRead, BlockHeader::kSize + slot.input.size());
+        return true;
+      },
+      [this](BlockPipeline::Slot& slot, size_t coder) {
+        slot.output.resize(slot.header.original_size);
+        try {
+          block_codecs_[coder]->decode_block(slot.header, slot.input.data(),
+                                             slot.output.data());
+        } catch (const std::runtime_error& e) {
+          throw std::runtime_error("Failed to decompress file: " +
+                                   std::string(e.what()));
+        }
+      },
+      [&](BlockPipeline::Slot& slot) {
+        StageClock clock(stage_stats());
+        output.write(reinterpret_cast<const char*>(slot.output.data()),
+                     slot.output.size());
+        clock.lap(CodecStats::kWrite, slot.output.size());
+        stats_.original_bytes += slot.output.size();
+        progress.add(BlockHeader::kSize + slot.input.size());
+      });
+
+  progress.finish();
+  stats_.compressed_bytes = file_size > 0 ? file_size : read_position;
+}
+
+void Encoder::decompress_legacy(std::istream& input, std::ostream& output,
+                                uint32_t num_unique_chars) {
+  // 1. Read header and build Huffman tree and its decode table
+  auto frequencies = read_header(input, num_unique_chars);
+  huffman_tree_.build_tree_compatible(frequencies);
+  huffman_decoder_.build(huffman_tree_);
 
   // Calculate total original size from frequencies
   size_t total_original_size = 0;
@@ -189,21 +721,79 @@ void Encoder::decompress(const std::string& input_file,
     total_original_size += freq.second;
   }
 
+  ProgressReporter progress(ProgressReporter::Kind::kDecompress,
+                            total_original_size, progress_enabled());
+
+  // 2. Set up the chunked input and output buffers; keep enough input
+  // loaded that a whole batch of worst-case codes fits
+  const uint64_t max_code_length = huffman_decoder_.max_code_length();
+  const uint64_t refill_threshold = max_code_length * 64;
+
+  std::vector<uint8_t> input_buffer(
+      std::max<size_t>(buffer_size_, refill_threshold / 4));
+  std::vector<uint8_t> output_buffer(buffer_size_);
+  size_t input_fill = 0;
+  size_t output_fill = 0;
+  bool input_done = false;
+  FastBitReader bit_reader;
+
+  // 3. Decompress data chunk by chunk
   size_t processed_bytes = 0;
+  // Symbol count and a byte plus a count per symbol
+  uint64_t read_bytes = 4 + uint64_t{num_unique_chars} * 9;
+  StageClock clock(stage_stats());
   try {
     while (processed_bytes < total_original_size) {
-      uint8_t decoded_byte = huffman_tree_.decode_byte(bit_stream_);
-      output.write(reinterpret_cast<const char*>(&decoded_byte), 1);
-      processed_bytes++;
+      if (!input_done && bit_reader.bits_remaining() < refill_threshold) {
+        // Move the unread tail to the front and top up from the file
+        size_t unread = bit_reader.unread_bytes();
+        std::copy(input_buffer.begin() + (input_fill - unread),
+                  input_buffer.begin() + input_fill, input_buffer.begin());
+        size_t wanted = input_buffer.size() - unread;
+        input.read(reinterpret_cast<char*>(input_buffer.data() + unread),
+                   wanted);
+        size_t got = static_cast<size_t>(input.gcount());
+        input_done = got < wanted;
+        input_fill = unread + got;
+        bit_reader.rebase(input_buffer.data(), input_fill);
+        read_bytes += got;
+        clock.lap(CodecStats::kRead, got);
+      }
 
-      if (processed_bytes % 1000 == 0) {
-        bar.set_progress((processed_bytes * 100) / total_original_size);
+      // Symbols that can be decoded without running out of loaded input
+      uint64_t batch = total_original_size - processed_bytes;
+      if (!input_done) {
+        batch = std::min<uint64_t>(
+            batch, (bit_reader.bits_remaining() - max_code_length) /
+                       max_code_length);
+      }
+      batch = std::min<uint64_t>(batch, output_buffer.size() - output_fill);
+
+      huffman_decoder_.decode(bit_reader, output_buffer.data() + output_fill,
+                              batch);
+      output_fill += batch;
+      processed_bytes += batch;
+      clock.lap(CodecStats::kDecode, batch);
+
+      if (output_fill == output_buffer.size()) {
+        output.write(reinterpret_cast<const char*>(output_buffer.data()),
+                     output_fill);
+        clock.lap(CodecStats::kWrite, output_fill);
+        output_fill = 0;
       }
+
+      progress.add(batch);
     }
   } catch (const std::runtime_error& e) {
     throw std::runtime_error("Failed to decompress file: " +
                              std::string(e.what()));
   }
 
-  bar.set_progress(100);
+  output.write(reinterpret_cast<const char*>(output_buffer.data()),
+               output_fill);
+  clock.lap(CodecStats::kWrite, output_fill);
+
+  progress.finish();
+  stats_.original_bytes = processed_bytes;
+  stats_.compressed_bytes = read_bytes;
 }
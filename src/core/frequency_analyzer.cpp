@@ -1,24 +1,151 @@
 #include "core/frequency_analyzer.hpp"
 
-#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <map>
-#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "core/input_source.hpp"
+
+namespace {
+
+// Runs of one byte value would serialize on a single counter, so bytes
+// are spread over four tables and summed at the end. 32-bit counters keep
+// the tables in 4 KiB; callers feed at most kMaxKernelBytes per call.
+constexpr size_t kMaxKernelBytes = size_t{1} << 31;
+
+void count_kernel(const uint8_t* data, size_t size,
+                  FrequencyAnalyzer::Histogram& histogram) {
+  uint32_t tables[4][256] = {};
+
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    tables[0][word & 0xFF]++;
+    tables[1][(word >> 8) & 0xFF]++;
+    tables[2][(word >> 16) & 0xFF]++;
+    tables[3][(word >> 24) & 0xFF]++;
+    tables[0][(word >> 32) & 0xFF]++;
+    tables[1][(word >> 40) & 0xFF]++;
+    tables[2][(word >> 48) & 0xFF]++;
+    tables[3][word >> 56]++;
+  }
+  for (; i < size; ++i) {
+    tables[0][data[i]]++;
+  }
+
+  for (size_t b = 0; b < 256; ++b) {
+    histogram[b] += uint64_t{tables[0][b]} + tables[1][b] + tables[2][b] +
+                    tables[3][b];
+  }
+}
+
+}  // namespace
 
 std::map<uint8_t, uint64_t> FrequencyAnalyzer::analyze_file(
     const std::string& file_name) const {
-  std::map<uint8_t, uint64_t> frequency_map;
-  std::ifstream file(file_name, std::ios::binary);
+  InputSource source(file_name);
+  return analyze_source(source);
+}
 
-  if (!file.is_open()) {
-    throw std::runtime_error("Could not open file: " + file_name);
+std::map<uint8_t, uint64_t> FrequencyAnalyzer::analyze_source(
+    InputSource& source) const {
+  Histogram histogram{};
+
+  // Mapped sources hand out views into the mapping, so nothing is copied
+  std::vector<uint8_t> scratch;
+  for (;;) {
+    InputSource::Span span = source.read(kChunkSize, scratch);
+    if (span.size == 0) {
+      break;
+    }
+    count(span.data, span.size, histogram);
   }
 
-  char buffer[4096];
-  while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
-    for (int i = 0; i < file.gcount(); ++i) {
-      frequency_map[static_cast<uint8_t>(buffer[i])]++;
+  source.rewind();
+  return to_map(histogram);
+}
+
+std::map<uint8_t, uint64_t> FrequencyAnalyzer::analyze_buffer(
+    const uint8_t* data, size_t size) const {
+  Histogram histogram{};
+  count(data, size, histogram);
+  return to_map(histogram);
+}
+
+void FrequencyAnalyzer::count(const uint8_t* data, size_t size,
+                              Histogram& histogram) {
+  while (size > 0) {
+    size_t chunk = std::min(size, kMaxKernelBytes);
+    count_kernel(data, chunk, histogram);
+    data += chunk;
+    size -= chunk;
+  }
+}
+
+FrequencyAnalyzer::Histogram FrequencyAnalyzer::count_parallel(
+    const uint8_t* data, size_t size, int num_threads) {
+  // Below this many bytes per thread, startup costs more than it saves
+  constexpr size_t kMinBytesPerThread = size_t{1} << 20;
+
+  size_t threads = static_cast<size_t>(std::max(num_threads, 1));
+  threads = std::min(threads, std::max<size_t>(size / kMinBytesPerThread, 1));
+
+  Histogram histogram{};
+  if (threads == 1) {
+    count(data, size, histogram);
+    return histogram;
+  }
+
+  // Disjoint ranges into private histograms, merged afterwards
+  std::vector<Histogram> partials(threads, Histogram{});
+  std::vector<std::thread> workers;
+  size_t range = (size + threads - 1) / threads;
+  for (size_t t = 0; t < threads; ++t) {
+    size_t begin = std::min(size, t * range);
+    size_t end = std::min(size, begin + range);
+    workers.emplace_back([data, begin, end, &partials, t] {
+      count(data + begin, end - begin, partials[t]);
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  for (const auto& partial : partials) {
+    for (size_t b = 0; b < 256; ++b) {
+      histogram[b] += partial[b];
     }
   }
+  return histogram;
+}
 
+std::map<uint8_t, uint64_t> FrequencyAnalyzer::to_map(
+    const Histogram& histogram) {
+  std::map<uint8_t, uint64_t> frequency_map;
+  for (size_t b = 0; b < 256; ++b) {
+    if (histogram[b] > 0) {
+      frequency_map.emplace_hint(frequency_map.end(), static_cast<uint8_t>(b),
+                                 histogram[b]);
+    }
+  }
   return frequency_map;
 }
+
+double FrequencyAnalyzer::entropy_bits(const Histogram& histogram) {
+  uint64_t total = 0;
+  for (uint64_t count : histogram) {
+    total += count;
+  }
+
+  double bits = 0.0;
+  for (uint64_t count : histogram) {
+    if (count > 0) {
+      bits += count * std::log2(static_cast<double>(total) / count);
+    }
+  }
+  return bits;
+}
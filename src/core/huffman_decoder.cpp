@@ -0,0 +1,400 @@
+#include "core/huffman_decoder.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/bit_stream.hpp"
+#include "core/canonical_code.hpp"
+#include "core/fast_bit_stream.hpp"
+#include "core/huffman_tree.hpp"
+
+void HuffmanDecoder::build(const HuffmanTree& tree) {
+  if (tree.empty()) {
+    throw std::runtime_error("HuffmanDecoder: Tree is empty");
+  }
+
+  table_.clear();
+
+  max_code_length_ = std::max(subtree_height(tree, tree.root), 1);
+  primary_bits_ = primary_table_bits(SIZE_MAX);
+  table_.resize(size_t{1} << primary_bits_);
+  fill_table(tree, tree.root, 0, primary_bits_, 0, 0);
+  update_single_lookup();
+}
+
+void HuffmanDecoder::build(const CanonicalCode& code, size_t symbols) {
+  codes_.clear();
+  for (size_t symbol = 0; symbol < 256; ++symbol) {
+    uint8_t length = code.length(static_cast<uint8_t>(symbol));
+    if (length > 0) {
+      codes_.push_back(CodeEntry{code.code(static_cast<uint8_t>(symbol)),
+                                 length, static_cast<uint8_t>(symbol)});
+    }
+  }
+  if (codes_.empty()) {
+    throw std::runtime_error("HuffmanDecoder: Code is empty");
+  }
+
+  // In bit order, codes that pass through the same table slot are
+  // neighbours, so every sub-table covers one contiguous run
+  std::sort(codes_.begin(), codes_.end(),
+            [](const CodeEntry& a, const CodeEntry& b) {
+              return (a.code << (64 - a.length)) <
+                     (b.code << (64 - b.length));
+            });
+
+  table_.clear();
+  max_code_length_ = code.max_length();
+  primary_bits_ = primary_table_bits(symbols);
+  table_.resize(size_t{1} << primary_bits_);
+  fill_codes(codes_.data(), codes_.data() + codes_.size(), 0, primary_bits_,
+             0);
+  update_single_lookup();
+}
+
+int HuffmanDecoder::primary_table_bits(size_t symbols) const {
+  // Small alphabets get a primary table no wider than the code itself,
+  // and so do length-limited codes, up to kMaxPrimaryBits, when there
+  // are enough symbols to pay for the entries
+  if (max_code_length_ <= kPrimaryBits ||
+      (max_code_length_ <= kMaxPrimaryBits &&
+       (size_t{1} << max_code_length_) <= symbols)) {
+    return max_code_length_;
+  }
+  return kPrimaryBits;
+}
+
+void HuffmanDecoder::update_single_lookup() {
+  single_lookup_ =
+      table_.size() == (size_t{1} << primary_bits_) &&
+      std::all_of(table_.begin(), table_.end(), [](const Entry& entry) {
+        return entry.kind == EntryKind::kLeaf;
+      });
+}
+
+void HuffmanDecoder::fill_codes(const CodeEntry* begin, const CodeEntry* end,
+                                size_t table_offset, int table_bits,
+                                int consumed) {
+  // Index of this table a code passes through
+  auto slot = [consumed, table_bits](const CodeEntry& entry) {
+    uint64_t aligned = entry.code << (64 - entry.length);
+    return static_cast<uint32_t>((aligned << consumed) >> (64 - table_bits));
+  };
+
+  for (const CodeEntry* entry = begin; entry != end;) {
+    int remaining = entry->length - consumed;
+    if (remaining <= table_bits) {
+      uint64_t suffix = entry->code & ((uint64_t{1} << remaining) - 1);
+      int free_bits = table_bits - remaining;
+      size_t first = table_offset + (static_cast<size_t>(suffix) << free_bits);
+      for (size_t i = 0; i < (size_t{1} << free_bits); ++i) {
+        Entry& leaf = table_[first + i];
+        leaf.value = entry->symbol;
+        leaf.length = static_cast<uint8_t>(remaining);
+        leaf.kind = EntryKind::kLeaf;
+      }
+      ++entry;
+      continue;
+    }
+
+    // Longer codes sharing this slot continue in a sub-table
+    uint32_t index = slot(*entry);
+    const CodeEntry* group_end = entry;
+    int max_remaining = 0;
+    while (group_end != end && slot(*group_end) == index) {
+      max_remaining = std::max(max_remaining,
+                               group_end->length - consumed - table_bits);
+      ++group_end;
+    }
+
+    int sub_bits = std::min(max_remaining, kMaxSubTableBits);
+    size_t sub_offset = table_.size();
+    table_.resize(sub_offset + (size_t{1} << sub_bits));
+
+    Entry& link = table_[table_offset + index];
+    link.value = static_cast<uint32_t>(sub_offset);
+    link.length = static_cast<uint8_t>(sub_bits);
+    link.kind = EntryKind::kLink;
+
+    fill_codes(entry, group_end, sub_offset, sub_bits, consumed + table_bits);
+    entry = group_end;
+  }
+}
+
+void HuffmanDecoder::fill_table(const HuffmanTree& tree,
+                                uint16_t node_index, size_t table_offset,
+                                int table_bits, uint32_t prefix, int depth) {
+  if (node_index == HuffmanTree::kNoNode) {
+    return;  // Missing branch, entries stay invalid
+  }
+
+  const auto& node = tree.nodes[node_index];
+  if (node.is_leaf) {
+    // Every index starting with this code maps to the leaf
+    int free_bits = table_bits - depth;
+    size_t first = table_offset + (static_cast<size_t>(prefix) << free_bits);
+    for (size_t i = 0; i < (size_t{1} << free_bits); ++i) {
+      Entry& entry = table_[first + i];
+      entry.value = node.byte;
+      entry.length = static_cast<uint8_t>(depth);
+      entry.kind = EntryKind::kLeaf;
+    }
+    return;
+  }
+
+  if (depth == table_bits) {
+    // Code continues past this table, chain into a sub-table
+    int sub_bits =
+        std::min(subtree_height(tree, node_index), kMaxSubTableBits);
+    size_t sub_offset = table_.size();
+    table_.resize(sub_offset + (size_t{1} << sub_bits));
+
+    Entry& link = table_[table_offset + prefix];
+    link.value = static_cast<uint32_t>(sub_offset);
+    link.length = static_cast<uint8_t>(sub_bits);
+    link.kind = EntryKind::kLink;
+
+    fill_table(tree, node.left, sub_offset, sub_bits, 0, 1);
+    fill_table(tree, node.right, sub_offset, sub_bits, 1, 1);
+    return;
+  }
+
+  fill_table(tree, node.left, table_offset, table_bits, prefix << 1,
+             depth + 1);
+  fill_table(tree, node.right, table_offset, table_bits, (prefix << 1) | 1,
+             depth + 1);
+}
+
+int HuffmanDecoder::subtree_height(const HuffmanTree& tree,
+                                   uint16_t node_index) {
+  if (node_index == HuffmanTree::kNoNode ||
+      tree.nodes[node_index].is_leaf) {
+    return 0;
+  }
+  const auto& node = tree.nodes[node_index];
+  return 1 + std::max(subtree_height(tree, node.left),
+                      subtree_height(tree, node.right));
+}
+
+uint8_t HuffmanDecoder::decode_symbol(BitStream& bit_stream) const {
+  if (table_.empty()) {
+    throw std::runtime_error("HuffmanDecoder: Table is empty");
+  }
+
+  size_t offset = 0;
+  int bits = primary_bits_;
+  for (;;) {
+    const Entry& entry = table_[offset + bit_stream.peek_bits(bits)];
+    switch (entry.kind) {
+      case EntryKind::kLeaf:
+        bit_stream.skip_bits(entry.length);
+        return static_cast<uint8_t>(entry.value);
+      case EntryKind::kLink:
+        bit_stream.skip_bits(bits);
+        offset = entry.value;
+        bits = entry.length;
+        break;
+      default:
+        throw std::runtime_error("HuffmanDecoder: Invalid code sequence");
+    }
+  }
+}
+
+void HuffmanDecoder::decode(BitStream& bit_stream, uint8_t* out,
+                            size_t count) const {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = decode_symbol(bit_stream);
+  }
+}
+
+uint8_t HuffmanDecoder::decode_symbol(FastBitReader& reader) const {
+  if (table_.empty()) {
+    throw std::runtime_error("HuffmanDecoder: Table is empty");
+  }
+
+  reader.refill();
+  const Entry& entry = table_[reader.peek_bits(primary_bits_)];
+  if (entry.kind == EntryKind::kLeaf) {
+    reader.consume_bits(entry.length);
+    return static_cast<uint8_t>(entry.value);
+  }
+  return decode_linked(reader, entry);
+}
+
+void HuffmanDecoder::decode(FastBitReader& reader, uint8_t* out,
+                            size_t count) const {
+  if (table_.empty()) {
+    throw std::runtime_error("HuffmanDecoder: Table is empty");
+  }
+
+  const Entry* table = table_.data();
+  const int primary_bits = primary_bits_;
+  size_t i = 0;
+
+  if (single_lookup_) {
+    // No links or holes: decode several symbols per refill without looking
+    // at the entry kind
+    const size_t per_refill =
+        static_cast<size_t>(FastBitReader::kMaxPeekBits / primary_bits);
+    while (count - i >= per_refill) {
+      reader.refill();
+      for (size_t k = 0; k < per_refill; ++k) {
+        const Entry& entry = table[reader.peek_bits(primary_bits)];
+        reader.consume_bits(entry.length);
+        out[i++] = static_cast<uint8_t>(entry.value);
+      }
+    }
+  }
+
+  for (; i < count; ++i) {
+    reader.refill();
+    const Entry& entry = table[reader.peek_bits(primary_bits)];
+    if (entry.kind == EntryKind::kLeaf) {
+      reader.consume_bits(entry.length);
+      out[i] = static_cast<uint8_t>(entry.value);
+    } else {
+      out[i] = decode_linked(reader, entry);
+    }
+  }
+}
+
+void HuffmanDecoder::decode_interleaved(FastBitReader* readers,
+                                        uint8_t* const* outs,
+                                        size_t count) const {
+  if (table_.empty()) {
+    throw std::runtime_error("HuffmanDecoder: Table is empty");
+  }
+
+  const Entry* table = table_.data();
+  const int primary_bits = primary_bits_;
+  // Local copies so the four accumulators can live in registers
+  FastBitReader r0 = readers[0];
+  FastBitReader r1 = readers[1];
+  FastBitReader r2 = readers[2];
+  FastBitReader r3 = readers[3];
+  uint8_t* o0 = outs[0];
+  uint8_t* o1 = outs[1];
+  uint8_t* o2 = outs[2];
+  uint8_t* o3 = outs[3];
+  size_t i = 0;
+
+  if (single_lookup_) {
+    const size_t per_refill =
+        static_cast<size_t>(FastBitReader::kMaxPeekBits / primary_bits);
+    while (count - i >= per_refill) {
+      r0.refill();
+      r1.refill();
+      r2.refill();
+      r3.refill();
+      for (size_t k = 0; k < per_refill; ++k, ++i) {
+        const Entry& e0 = table[r0.peek_bits(primary_bits)];
+        const Entry& e1 = table[r1.peek_bits(primary_bits)];
+        const Entry& e2 = table[r2.peek_bits(primary_bits)];
+        const Entry& e3 = table[r3.peek_bits(primary_bits)];
+        r0.consume_bits(e0.length);
+        r1.consume_bits(e1.length);
+        r2.consume_bits(e2.length);
+        r3.consume_bits(e3.length);
+        o0[i] = static_cast<uint8_t>(e0.value);
+        o1[i] = static_cast<uint8_t>(e1.value);
+        o2[i] = static_cast<uint8_t>(e2.value);
+        o3[i] = static_cast<uint8_t>(e3.value);
+      }
+    }
+  }
+
+  auto next = [&](FastBitReader& reader) {
+    reader.refill();
+    const Entry& entry = table[reader.peek_bits(primary_bits)];
+    if (entry.kind == EntryKind::kLeaf) {
+      reader.consume_bits(entry.length);
+      return static_cast<uint8_t>(entry.value);
+    }
+    return decode_linked(reader, entry);
+  };
+  for (; i < count; ++i) {
+    o0[i] = next(r0);
+    o1[i] = next(r1);
+    o2[i] = next(r2);
+    o3[i] = next(r3);
+  }
+
+  readers[0] = r0;
+  readers[1] = r1;
+  readers[2] = r2;
+  readers[3] = r3;
+}
+
+void HuffmanDecoder::decode_order1(const HuffmanDecoder* const* decoders,
+                                   FastBitReader& reader, uint8_t* out,
+                                   size_t count) {
+  // Flat per-context copies keep the next table one load away from the
+  // previous symbol
+  const Entry* tables[256];
+  int primary_bits[256];
+  int widest = 1;
+  bool single_lookup = true;
+  for (size_t context = 0; context < 256; ++context) {
+    const HuffmanDecoder& decoder = *decoders[context];
+    if (decoder.table_.empty()) {
+      throw std::runtime_error("HuffmanDecoder: Table is empty");
+    }
+    tables[context] = decoder.table_.data();
+    primary_bits[context] = decoder.primary_bits_;
+    widest = std::max(widest, decoder.primary_bits_);
+    single_lookup &= decoder.single_lookup_;
+  }
+
+  uint8_t previous = 0;
+  size_t i = 0;
+  if (single_lookup) {
+    const size_t per_refill =
+        static_cast<size_t>(FastBitReader::kMaxPeekBits / widest);
+    while (count - i >= per_refill) {
+      reader.refill();
+      for (size_t k = 0; k < per_refill; ++k) {
+        const Entry& entry =
+            tables[previous][reader.peek_bits(primary_bits[previous])];
+        reader.consume_bits(entry.length);
+        previous = static_cast<uint8_t>(entry.value);
+        out[i++] = previous;
+      }
+    }
+  }
+
+  for (; i < count; ++i) {
+    reader.refill();
+    const Entry& entry =
+        tables[previous][reader.peek_bits(primary_bits[previous])];
+    if (entry.kind == EntryKind::kLeaf) {
+      reader.consume_bits(entry.length);
+      previous = static_cast<uint8_t>(entry.value);
+    } else {
+      previous = decoders[previous]->decode_linked(reader, entry);
+    }
+    out[i] = previous;
+  }
+}
+
+uint8_t HuffmanDecoder::decode_linked(FastBitReader& reader,
+                                      const Entry& link) const {
+  const Entry* entry = &link;
+  int bits = primary_bits_;
+  for (;;) {
+    switch (entry->kind) {
+      case EntryKind::kLeaf:
+        reader.consume_bits(entry->length);
+        return static_cast<uint8_t>(entry->value);
+      case EntryKind::kLink: {
+        reader.consume_bits(bits);
+        reader.refill();
+        size_t offset = entry->value;
+        bits = entry->length;
+        entry = &table_[offset + reader.peek_bits(bits)];
+        break;
+      }
+      default:
+        throw std::runtime_error("HuffmanDecoder: Invalid code sequence");
+    }
+  }
+}
@@ -1,131 +1,319 @@
 #include "core/huffman_tree.hpp"
 
 #include <algorithm>
-#include <functional>
-#include <queue>
 #include <stdexcept>
 #include <vector>
 
 #include "core/bit_stream.hpp"
 
+uint16_t HuffmanTree::add_node(uint64_t frequency, uint16_t left,
+                               uint16_t right) {
+  Node& node = nodes[num_nodes];
+  node.frequency = frequency;
+  node.left = left;
+  node.right = right;
+  node.byte = 0;
+  node.is_leaf = false;
+  return num_nodes++;
+}
+
+uint16_t HuffmanTree::add_leaf(uint8_t byte, uint64_t frequency) {
+  Node& node = nodes[num_nodes];
+  node.frequency = frequency;
+  node.left = kNoNode;
+  node.right = kNoNode;
+  node.byte = byte;
+  node.is_leaf = true;
+  return num_nodes++;
+}
+
+void HuffmanTree::finish_tree(uint16_t top) {
+  if (nodes[top].is_leaf) {
+    // Special case: only one unique character in the file
+    // Create a dummy root with the leaf as left child
+    root = add_node(nodes[top].frequency, top, kNoNode);
+  } else {
+    root = top;
+  }
+}
+
 void HuffmanTree::build_tree(const std::map<uint8_t, uint64_t>& frequencies) {
   if (frequencies.empty()) {
     throw std::invalid_argument("Frequencies map cannot be empty");
   }
 
-  auto cmp = [](const std::unique_ptr<Node>& a,
-                const std::unique_ptr<Node>& b) {
-    return a->frequency > b->frequency;
+  num_nodes = 0;
+  root = kNoNode;
+  for (const auto& pair : frequencies) {
+    add_leaf(pair.first, pair.second);
+  }
+  merge_leaves();
+}
+
+void HuffmanTree::build_tree(const std::array<uint64_t, 256>& counts) {
+  num_nodes = 0;
+  root = kNoNode;
+  for (size_t byte = 0; byte < counts.size(); ++byte) {
+    if (counts[byte] > 0) {
+      add_leaf(static_cast<uint8_t>(byte), counts[byte]);
+    }
+  }
+  if (num_nodes == 0) {
+    throw std::invalid_argument("Frequencies map cannot be empty");
+  }
+  merge_leaves();
+}
+
+void HuffmanTree::merge_leaves() {
+  // Leaves take the first slots, sorted by frequency
+  std::array<uint16_t, 256> leaves{};
+  size_t num_leaves = num_nodes;
+  for (size_t i = 0; i < num_leaves; ++i) {
+    leaves[i] = static_cast<uint16_t>(i);
+  }
+  std::sort(leaves.begin(), leaves.begin() + num_leaves,
+            [this](uint16_t a, uint16_t b) {
+              if (nodes[a].frequency != nodes[b].frequency) {
+                return nodes[a].frequency < nodes[b].frequency;
+              }
+              return nodes[a].byte < nodes[b].byte;
+            });
+
+  // Internal nodes are created in non-decreasing frequency order, so the
+  // slots after the leaves form the second queue; the cheaper head of the
+  // two queues is always the next node to merge
+  size_t next_leaf = 0;
+  uint16_t next_internal = static_cast<uint16_t>(num_leaves);
+  auto take_min = [&]() -> uint16_t {
+    if (next_leaf < num_leaves &&
+        (next_internal == num_nodes ||
+         nodes[leaves[next_leaf]].frequency <=
+             nodes[next_internal].frequency)) {
+      return leaves[next_leaf++];
+    }
+    return next_internal++;
+  };
+
+  uint16_t top = leaves[0];
+  for (size_t merges = 1; merges < num_leaves; ++merges) {
+    uint16_t left = take_min();
+    uint16_t right = take_min();
+    top = add_node(nodes[left].frequency + nodes[right].frequency, left,
+                   right);
+  }
+  finish_tree(top);
+}
+
+void HuffmanTree::build_tree_compatible(
+    const std::map<uint8_t, uint64_t>& frequencies) {
+  if (frequencies.empty()) {
+    throw std::invalid_argument("Frequencies map cannot be empty");
+  }
+
+  num_nodes = 0;
+  root = kNoNode;
+
+  // Same heap operations as std::priority_queue with the original
+  // comparator, on node indices instead of owned nodes
+  auto cmp = [this](uint16_t a, uint16_t b) {
+    return nodes[a].frequency > nodes[b].frequency;
   };
-  std::priority_queue<std::unique_ptr<Node>, std::vector<std::unique_ptr<Node>>,
-                      decltype(cmp)>
-      min_heap(cmp);
+  std::array<uint16_t, 256> heap{};
+  size_t heap_size = 0;
 
-  // Create leaf nodes for each byte and add them to the priority queue
   for (const auto& pair : frequencies) {
-    min_heap.push(std::make_unique<Node>(pair.first, pair.second, true));
-  }
-
-  // Build the Huffman tree
-  while (min_heap.size() > 1) {
-    // Move from the top of the priority queue
-    auto left = std::move(const_cast<std::unique_ptr<Node>&>(min_heap.top()));
-    min_heap.pop();
-    auto right = std::move(const_cast<std::unique_ptr<Node>&>(min_heap.top()));
-    min_heap.pop();
-
-    auto parent = std::make_unique<Node>(0, left->frequency + right->frequency);
-    parent->left = std::move(left);
-    parent->right = std::move(right);
-    parent->is_leaf = false;
-
-    min_heap.push(std::move(parent));
-  }
-
-  // Handle the final node(s) in the priority queue
-  if (min_heap.size() == 1) {
-    // Get the remaining node (could be a leaf or internal node)
-    auto remaining_node =
-        std::move(const_cast<std::unique_ptr<Node>&>(min_heap.top()));
-    min_heap.pop();
-
-    // Check if this is a single leaf node (edge case)
-    if (remaining_node->is_leaf) {
-      // Special case: only one unique character in the file
-      // Create a dummy root with the leaf as left child
-      auto dummy_root = std::make_unique<Node>(0, remaining_node->frequency);
-      dummy_root->left = std::move(remaining_node);
-      dummy_root->right = nullptr;
-      dummy_root->is_leaf = false;
-      root = std::move(dummy_root);
-    } else {
-      // This is the normal case - the root of a proper tree
-      root = std::move(remaining_node);
+    heap[heap_size++] = add_leaf(pair.first, pair.second);
+    std::push_heap(heap.begin(), heap.begin() + heap_size, cmp);
+  }
+
+  while (heap_size > 1) {
+    std::pop_heap(heap.begin(), heap.begin() + heap_size--, cmp);
+    uint16_t left = heap[heap_size];
+    std::pop_heap(heap.begin(), heap.begin() + heap_size--, cmp);
+    uint16_t right = heap[heap_size];
+
+    heap[heap_size++] =
+        add_node(nodes[left].frequency + nodes[right].frequency, left, right);
+    std::push_heap(heap.begin(), heap.begin() + heap_size, cmp);
+  }
+
+  finish_tree(heap[0]);
+}
+
+CodeTable HuffmanTree::code_table() const {
+  CodeTable table{};
+  if (root == kNoNode) {
+    return table;  // Empty tree
+  }
+
+  // Children always sit at lower indices than their parent, so one pass
+  // from the root downwards hands every node its code
+  std::array<Code, kMaxNodes> codes;
+  codes[root] = Code{};
+  for (int index = root; index >= 0; --index) {
+    const Node& node = nodes[index];
+    const Code& code = codes[index];
+    if (node.is_leaf) {
+      table[node.byte] = code;
+      continue;
+    }
+
+    if (code.length == 64) {
+      throw std::runtime_error("HuffmanTree: Code longer than 64 bits");
+    }
+    uint8_t length = static_cast<uint8_t>(code.length + 1);
+    if (node.left != kNoNode) {
+      codes[node.left] = Code{code.bits << 1, length};
+    }
+    if (node.right != kNoNode) {
+      codes[node.right] = Code{(code.bits << 1) | 1, length};
     }
-  } else {
-    // This should never happen in normal flow
-    throw std::runtime_error(
-        "Unexpected state: priority queue should have exactly one element");
   }
+  return table;
 }
 
 std::map<uint8_t, std::string> HuffmanTree::generate_codes() const {
   std::map<uint8_t, std::string> codes;
 
-  if (!root) {
-    return codes;  // Empty tree
+  CodeTable table = code_table();
+  for (size_t symbol = 0; symbol < table.size(); ++symbol) {
+    const Code& code = table[symbol];
+    if (code.length == 0) continue;
+
+    std::string text(code.length, '0');
+    for (int i = 0; i < code.length; ++i) {
+      if ((code.bits >> (code.length - 1 - i)) & 1) {
+        text[i] = '1';
+      }
+    }
+    codes[static_cast<uint8_t>(symbol)] = text;
   }
+  return codes;
+}
 
-  // Special case: single character (root has only left child)
-  if (root->left && !root->right && root->left->is_leaf) {
-    codes[root->left->byte] = "0";  // Assign single bit code
-    return codes;
+std::array<uint8_t, 256> HuffmanTree::code_lengths() const {
+  std::array<uint8_t, 256> lengths{};
+  if (root == kNoNode) {
+    return lengths;
   }
 
-  std::function<void(const Node*, const std::string&)> generate_codes_helper;
+  std::array<uint8_t, kMaxNodes> depths;
+  depths[root] = 0;
+  for (int index = root; index >= 0; --index) {
+    const Node& node = nodes[index];
+    if (node.is_leaf) {
+      lengths[node.byte] = depths[index];
+      continue;
+    }
+    if (node.left != kNoNode) depths[node.left] = depths[index] + 1;
+    if (node.right != kNoNode) depths[node.right] = depths[index] + 1;
+  }
+  return lengths;
+}
 
-  generate_codes_helper = [&](const Node* node, const std::string& code) {
-    if (!node) return;
+std::array<uint8_t, 256> HuffmanTree::limited_code_lengths(
+    const std::map<uint8_t, uint64_t>& frequencies, int max_length) {
+  if (frequencies.empty()) {
+    throw std::invalid_argument("Frequencies map cannot be empty");
+  }
 
-    if (node->is_leaf) {
-      codes[node->byte] = code;
-      return;
-    }
+  std::array<uint8_t, 256> lengths{};
+  if (frequencies.size() == 1) {
+    lengths[frequencies.begin()->first] = 1;
+    return lengths;
+  }
+  if (max_length < 1 || max_length > 64 ||
+      (max_length < 9 && frequencies.size() > (size_t{1} << max_length))) {
+    throw std::invalid_argument("Code length limit too small for alphabet");
+  }
 
-    generate_codes_helper(node->left.get(), code + "0");
-    generate_codes_helper(node->right.get(), code + "1");
+  // An item is either a leaf or a package of two items from the list one
+  // level deeper; packages only remember where their halves came from.
+  struct Item {
+    uint64_t weight;
+    int symbol;  // -1 for packages
+    uint32_t left;
+    uint32_t right;
   };
 
-  generate_codes_helper(root.get(), "");
-  return codes;
+  std::vector<Item> leaves;
+  for (const auto& pair : frequencies) {
+    leaves.push_back(Item{pair.second, pair.first, 0, 0});
+  }
+  std::stable_sort(leaves.begin(), leaves.end(),
+                   [](const Item& a, const Item& b) {
+                     return a.weight < b.weight;
+                   });
+
+  // levels[0] holds the deepest list; each further level merges the leaves
+  // with pairs taken from the level before it
+  std::vector<std::vector<Item>> levels(1, leaves);
+  for (int level = 1; level < max_length; ++level) {
+    const std::vector<Item>& previous = levels.back();
+    std::vector<Item> merged;
+    merged.reserve(leaves.size() + previous.size() / 2);
+
+    size_t leaf = 0;
+    size_t pair = 0;
+    while (leaf < leaves.size() || pair + 1 < previous.size()) {
+      bool take_leaf = pair + 1 >= previous.size() ||
+                       (leaf < leaves.size() &&
+                        leaves[leaf].weight <=
+                            previous[pair].weight + previous[pair + 1].weight);
+      if (take_leaf) {
+        merged.push_back(leaves[leaf++]);
+      } else {
+        merged.push_back(Item{previous[pair].weight + previous[pair + 1].weight,
+                              -1, static_cast<uint32_t>(pair),
+                              static_cast<uint32_t>(pair + 1)});
+        pair += 2;
+      }
+    }
+    levels.push_back(std::move(merged));
+  }
+
+  // The cheapest 2n - 2 items of the last list decide the lengths: a symbol
+  // gets one bit for every selected item that contains it
+  std::vector<std::pair<int, uint32_t>> pending;
+  size_t selected = 2 * leaves.size() - 2;
+  for (size_t i = 0; i < selected; ++i) {
+    pending.emplace_back(max_length - 1, static_cast<uint32_t>(i));
+  }
+  while (!pending.empty()) {
+    auto [level, index] = pending.back();
+    pending.pop_back();
+    const Item& item = levels[level][index];
+    if (item.symbol >= 0) {
+      ++lengths[item.symbol];
+    } else {
+      pending.emplace_back(level - 1, item.left);
+      pending.emplace_back(level - 1, item.right);
+    }
+  }
+  return lengths;
 }
 
 uint8_t HuffmanTree::decode_byte(BitStream& bit_stream) const {
-  if (!root) {
+  if (root == kNoNode) {
     throw std::runtime_error("HuffmanTree: Tree is empty");
   }
 
-  const Node* current = root.get();
+  const Node* current = &nodes[root];
 
   // Handle single character case (dummy root with only left child)
-  if (current->left && !current->right && current->left->is_leaf) {
+  if (current->right == kNoNode) {
     // Read one bit (should be 0 for single character)
     bit_stream.read_bit();
-    return current->left->byte;
+    return nodes[current->left].byte;
   }
 
   // Traverse the tree following the bits
   while (!current->is_leaf) {
-    bool bit = bit_stream.read_bit();
-    if (bit) {
-      current = current->right.get();
-    } else {
-      current = current->left.get();
-    }
-
-    if (!current) {
+    uint16_t next = bit_stream.read_bit() ? current->right : current->left;
+    if (next == kNoNode) {
       throw std::runtime_error("HuffmanTree: Invalid code sequence");
     }
+    current = &nodes[next];
   }
 
   return current->byte;
@@ -0,0 +1,165 @@
+#include "core/input_source.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define QUICKCOMPRESS_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void InputSource::open(const std::string& file_name) {
+  close();
+  file_name_ = file_name;
+
+  // Standard input is read as it arrives, its size is never known
+  if (is_standard_stream(file_name)) {
+    stream_ = &std::cin;
+    return;
+  }
+
+  if (try_map(file_name)) {
+    return;
+  }
+
+  file_.open(file_name, std::ios::binary);
+  if (!file_.is_open()) {
+    throw std::runtime_error("Could not open input file: " + file_name);
+  }
+  stream_ = &file_;
+
+  // Regular files report their size; pipes fail the seek and stay unknown
+  file_.seekg(0, std::ios::end);
+  std::streamoff end = file_.tellg();
+  if (end >= 0) {
+    size_ = static_cast<uint64_t>(end);
+    size_known_ = true;
+  }
+  file_.clear();
+  file_.seekg(0, std::ios::beg);
+  file_.clear();
+}
+
+void InputSource::close() {
+#ifdef QUICKCOMPRESS_HAVE_MMAP
+  if (mapping_) {
+    munmap(const_cast<uint8_t*>(mapping_), size_);
+  }
+#endif
+  mapping_ = nullptr;
+  position_ = 0;
+  size_ = 0;
+  size_known_ = false;
+  if (file_.is_open()) {
+    file_.close();
+  }
+  file_.clear();
+  stream_ = nullptr;
+}
+
+bool InputSource::try_map(const std::string& file_name) {
+#ifdef QUICKCOMPRESS_HAVE_MMAP
+  int fd = ::open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                       MAP_PRIVATE, fd, 0);
+  ::close(fd);  // The mapping keeps the file referenced
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+
+  madvise(mapping, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+  mapping_ = static_cast<const uint8_t*>(mapping);
+  size_ = static_cast<uint64_t>(info.st_size);
+  size_known_ = true;
+  return true;
+#else
+  (void)file_name;
+  return false;
+#endif
+}
+
+InputSource::Span InputSource::read(size_t max_bytes,
+                                    std::vector<uint8_t>& scratch) {
+  Span span;
+
+  if (mapping_) {
+    span.data = mapping_ + position_;
+    span.size = std::min<uint64_t>(max_bytes, size_ - position_);
+    position_ += span.size;
+    return span;
+  }
+
+  if (!stream_) {
+    throw std::runtime_error("InputSource: No file is open");
+  }
+
+  scratch.resize(max_bytes);
+  size_t filled = 0;
+  while (filled < max_bytes && *stream_) {
+    stream_->read(reinterpret_cast<char*>(scratch.data() + filled),
+                  max_bytes - filled);
+    filled += static_cast<size_t>(stream_->gcount());
+  }
+  if (stream_->bad()) {
+    throw std::runtime_error("Failed to read input file: " + file_name_);
+  }
+
+  scratch.resize(filled);
+  span.data = scratch.data();
+  span.size = filled;
+  position_ += filled;
+  return span;
+}
+
+void InputSource::release(const Span& span) {
+#ifdef QUICKCOMPRESS_HAVE_MMAP
+  if (!mapping_ || span.size == 0) {
+    return;
+  }
+
+  // Whole pages only; the page holding the span's tail may still be shared
+  // with data that has not been consumed yet
+  static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t begin = static_cast<size_t>(span.data - mapping_);
+  size_t end = begin + span.size;
+  begin -= begin % page_size;
+  end -= end % page_size;
+  if (end > begin) {
+    madvise(const_cast<uint8_t*>(mapping_) + begin, end - begin,
+            MADV_DONTNEED);
+  }
+#else
+  (void)span;
+#endif
+}
+
+void InputSource::rewind() {
+  if (mapping_) {
+    position_ = 0;
+    return;
+  }
+
+  if (stream_ != &file_) {
+    throw std::runtime_error("Input cannot be rewound: " + file_name_);
+  }
+  file_.clear();
+  file_.seekg(0, std::ios::beg);
+  if (!file_) {
+    throw std::runtime_error("Input cannot be rewound: " + file_name_);
+  }
+  position_ = 0;
+}
@@ -0,0 +1,250 @@
+#include "core/memory_codec.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "core/canonical_code.hpp"
+
+size_t MemoryCodec::compress_bound(size_t size, size_t block_size) {
+  if (block_size == 0 || block_size > kMaxBlockSize) {
+    throw std::invalid_argument("Block size must be between 1 byte and " +
+                                std::to_string(kMaxBlockSize) + " bytes");
+  }
+
+  // No block body exceeds its input: a Huffman code never costs more than
+  // the flat 8-bit code, plus one byte of padding
+  size_t num_blocks = (size + block_size - 1) / block_size;
+  size_t per_block = BlockHeader::kSize + CanonicalCode::kMaxSerializedSize +
+                     1 + BlockIndexEntry::kSize;
+  return kFileHeaderSize + size + num_blocks * per_block +
+         BlockHeader::kSize + 4 + kIndexTrailerSize;
+}
+
+void MemoryCodec::set_block_size(size_t bytes) {
+  if (bytes == 0 || bytes > kMaxBlockSize) {
+    throw std::invalid_argument("Block size must be between 1 byte and " +
+                                std::to_string(kMaxBlockSize) + " bytes");
+  }
+  block_size_ = bytes;
+}
+
+void MemoryCodec::set_max_code_length(int bits) {
+  block_codec_.set_max_code_length(bits);
+}
+
+void MemoryCodec::set_shared_table(std::shared_ptr<const SharedTable> table) {
+  shared_table_ = std::move(table);
+  block_codec_.set_shared_table(shared_table_.get());
+}
+
+void MemoryCodec::compress(const uint8_t* data, size_t size,
+                           std::vector<uint8_t>& out) {
+  out.clear();
+  out.reserve(compress_bound(size, block_size_));
+  compress_into(data, size, out);
+}
+
+size_t MemoryCodec::compress(const uint8_t* data, size_t size, uint8_t* out,
+                             size_t capacity) {
+  // Coded straight into the caller's buffer, which throws if it fills up
+  BoundedBuffer buffer{out, capacity};
+  compress_into(data, size, buffer);
+  return buffer.size;
+}
+
+void MemoryCodec::compress_into(const uint8_t* data, size_t size,
+                                ByteSink out) {
+  size_t start = out.size();
+  // A single block has nothing to index
+  FileHeader header;
+  if (size > block_size_) {
+    header.flags = kFlagBlockIndex;
+  }
+  header.block_size = static_cast<uint32_t>(block_size_);
+  append_file_header(out, header);
+
+  block_index_.clear();
+  for (size_t offset = 0; offset < size; offset += block_size_) {
+    size_t block_size = std::min(block_size_, size - offset);
+
+    BlockIndexEntry entry;
+    entry.offset = out.size() - start;
+    block_codec_.encode_block(data + offset, block_size, out);
+    entry.stored_size = static_cast<uint32_t>(out.size() - start -
+                                              entry.offset);
+    entry.original_size = static_cast<uint32_t>(block_size);
+    block_index_.push_back(entry);
+  }
+
+  append_block_header(out, BlockHeader{});
+  if (header.flags & kFlagBlockIndex) {
+    append_block_index(out, block_index_, out.size() - start);
+  }
+}
+
+uint64_t MemoryCodec::decompressed_size(const uint8_t* data, size_t size) {
+  return walk_blocks(data, size, nullptr, nullptr, 0);
+}
+
+void MemoryCodec::decompress(const uint8_t* data, size_t size,
+                             std::vector<uint8_t>& out) {
+  uint64_t total = decompressed_size(data, size);
+  if (total > std::numeric_limits<size_t>::max()) {
+    throw std::runtime_error("MemoryCodec: Decompressed size too large");
+  }
+  out.resize(static_cast<size_t>(total));
+  walk_blocks(data, size, &block_codec_, out.data(), out.size());
+}
+
+size_t MemoryCodec::decompress(const uint8_t* data, size_t size,
+                               uint8_t* out, size_t capacity) {
+  return static_cast<size_t>(
+      walk_blocks(data, size, &block_codec_, out, capacity));
+}
+
+void MemoryCodec::decompress_range(const uint8_t* data, size_t size,
+                                   uint64_t offset, uint64_t length,
+                                   std::vector<uint8_t>& out) {
+  out.clear();
+  if (size == 0 || length == 0) {
+    return;
+  }
+  if (size < kFileHeaderSize + BlockHeader::kSize ||
+      !has_container_magic(data)) {
+    throw std::runtime_error("MemoryCodec: Not a .qcmp container");
+  }
+  FileHeader header = load_file_header(data + 4);
+  if (header.version != kContainerVersion) {
+    throw std::runtime_error("MemoryCodec: Unsupported container version: " +
+                             std::to_string(header.version));
+  }
+  if (header.block_size == 0 || header.block_size > kMaxBlockSize) {
+    throw std::runtime_error("MemoryCodec: Corrupt container header");
+  }
+
+  // Blocks holding the first and the last byte of the range
+  const uint64_t end =
+      length > UINT64_MAX - offset ? UINT64_MAX : offset + length;
+  const uint64_t first_block = offset / header.block_size;
+  uint64_t last_block = (end - 1) / header.block_size;
+
+  // Without an index there is at most one block, right after the header
+  uint64_t num_blocks = 0;
+  size_t index_offset = 0;
+  if (header.flags & kFlagBlockIndex) {
+    if (size < kFileHeaderSize + 4 + kIndexTrailerSize ||
+        !std::equal(kIndexMagic, kIndexMagic + 4, data + size - 4)) {
+      throw std::runtime_error("MemoryCodec: Missing block index trailer");
+    }
+    uint64_t trailer_offset = load_u64(data + size - kIndexTrailerSize);
+    if (trailer_offset < kFileHeaderSize ||
+        trailer_offset > size - kIndexTrailerSize - 4) {
+      throw std::runtime_error("MemoryCodec: Corrupt block index offset");
+    }
+    index_offset = static_cast<size_t>(trailer_offset);
+    num_blocks = load_u32(data + index_offset);
+    if (size - kIndexTrailerSize - index_offset !=
+        4 + num_blocks * BlockIndexEntry::kSize) {
+      throw std::runtime_error("MemoryCodec: Corrupt block index size");
+    }
+  } else if (load_block_header(data + kFileHeaderSize).original_size > 0) {
+    num_blocks = 1;
+  }
+  if (first_block >= num_blocks) {
+    return;
+  }
+  last_block = std::min(last_block, num_blocks - 1);
+
+  for (uint64_t block = first_block; block <= last_block; ++block) {
+    size_t position = kFileHeaderSize;
+    if (index_offset > 0) {
+      BlockIndexEntry entry = load_block_index_entry(
+          data + block_index_entry_offset(index_offset, block));
+      if (entry.offset < kFileHeaderSize ||
+          entry.stored_size < BlockHeader::kSize ||
+          entry.offset + entry.stored_size > index_offset) {
+        throw std::runtime_error("MemoryCodec: Corrupt block index entry");
+      }
+      position = static_cast<size_t>(entry.offset);
+    }
+
+    BlockHeader block_header = load_block_header(data + position);
+    position += BlockHeader::kSize;
+    if (block_header.original_size == 0 ||
+        block_header.original_size > header.block_size ||
+        block_header.compressed_size > size - position) {
+      throw std::runtime_error("MemoryCodec: Corrupt block header");
+    }
+    // A short block before the last would shift every later offset
+    if (block + 1 < num_blocks &&
+        block_header.original_size != header.block_size) {
+      throw std::runtime_error("MemoryCodec: Container is not seekable");
+    }
+
+    // Decode straight into out, then drop what lies outside the range
+    const uint64_t block_start = block * header.block_size;
+    size_t from = static_cast<size_t>(std::max(offset, block_start) -
+                                      block_start);
+    size_t to = static_cast<size_t>(
+        std::min<uint64_t>(block_header.original_size, end - block_start));
+    if (to <= from) {
+      break;
+    }
+    size_t kept = out.size();
+    out.resize(kept + block_header.original_size);
+    block_codec_.decode_block(block_header, data + position,
+                              out.data() + kept);
+    out.erase(out.begin() + kept + to, out.end());
+    out.erase(out.begin() + kept, out.begin() + kept + from);
+  }
+}
+
+uint64_t MemoryCodec::walk_blocks(const uint8_t* data, size_t size,
+                                  BlockCodec* codec, uint8_t* out,
+                                  size_t capacity) {
+  // Like an empty file, empty input decompresses to nothing
+  if (size == 0) {
+    return 0;
+  }
+  if (size < kFileHeaderSize || !has_container_magic(data)) {
+    throw std::runtime_error("MemoryCodec: Not a .qcmp container");
+  }
+
+  FileHeader header = load_file_header(data + 4);
+  if (header.version != kContainerVersion) {
+    throw std::runtime_error("MemoryCodec: Unsupported container version: " +
+                             std::to_string(header.version));
+  }
+
+  size_t position = kFileHeaderSize;
+  uint64_t total = 0;
+  for (;;) {
+    if (size - position < BlockHeader::kSize) {
+      throw std::runtime_error("MemoryCodec: Truncated block header");
+    }
+    BlockHeader block_header = load_block_header(data + position);
+    position += BlockHeader::kSize;
+    if (block_header.original_size == 0) {
+      break;
+    }
+
+    if (block_header.original_size > header.block_size ||
+        block_header.compressed_size > size - position) {
+      throw std::runtime_error("MemoryCodec: Corrupt block header");
+    }
+
+    if (codec) {
+      if (block_header.original_size > capacity - total) {
+        throw std::runtime_error("MemoryCodec: Output buffer too small");
+      }
+      codec->decode_block(block_header, data + position, out + total);
+    }
+    position += block_header.compressed_size;
+    total += block_header.original_size;
+  }
+  return total;
+}
@@ -0,0 +1,77 @@
+#include "core/progress_reporter.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "indicators/progress_bar.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <io.h>
+
+#include <cstdio>
+#endif
+
+ProgressReporter::ProgressReporter(Kind kind, uint64_t total, bool enabled,
+                                   std::ostream& stream)
+    : total_(total) {
+  if (!enabled || total == 0) {
+    return;
+  }
+
+  bool compressing = kind == Kind::kCompress;
+  bar_ = std::make_unique<indicators::ProgressBar>(
+      indicators::option::BarWidth{50}, indicators::option::Start{"["},
+      indicators::option::Fill{"="}, indicators::option::Lead{">"},
+      indicators::option::Remainder{" "}, indicators::option::End{"]"},
+      indicators::option::PostfixText{compressing ? "Compressing file"
+                                                  : "Decompressing file"},
+      indicators::option::ForegroundColor{compressing
+                                              ? indicators::Color::green
+                                              : indicators::Color::yellow},
+      indicators::option::FontStyles{
+          std::vector<indicators::FontStyle>{indicators::FontStyle::bold}},
+      indicators::option::Stream{stream});
+  sampler_ = std::thread([this] { sample(); });
+}
+
+ProgressReporter::~ProgressReporter() { stop(); }
+
+void ProgressReporter::sample() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_requested_.wait_for(lock, kInterval,
+                                   [this] { return stopping_; })) {
+    uint64_t done = std::min(done_.load(std::memory_order_relaxed), total_);
+    bar_->set_progress(static_cast<size_t>(done * 100 / total_));
+  }
+}
+
+void ProgressReporter::stop() {
+  if (!sampler_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  stop_requested_.notify_one();
+  sampler_.join();
+}
+
+void ProgressReporter::finish() {
+  stop();
+  if (bar_) {
+    bar_->set_progress(100);
+  }
+}
+
+bool ProgressReporter::stderr_is_terminal() {
+#if defined(__unix__) || defined(__APPLE__)
+  return isatty(STDERR_FILENO) != 0;
+#elif defined(_WIN32)
+  return _isatty(_fileno(stderr)) != 0;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,123 @@
+#include "core/shared_table.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include "core/container_format.hpp"
+#include "core/huffman_tree.hpp"
+#include "core/input_source.hpp"
+
+namespace {
+
+constexpr uint8_t kTableMagic[4] = {'Q', 'T', 'B', 'L'};
+constexpr uint8_t kTableVersion = 1;
+constexpr size_t kTableHeaderSize = 9;
+
+}  // namespace
+
+void SharedTable::add_sample(const uint8_t* data, size_t size) {
+  FrequencyAnalyzer::count(data, size, counts_);
+}
+
+void SharedTable::add_sample_file(const std::string& file_name) {
+  InputSource input(file_name);
+  std::vector<uint8_t> scratch;
+  for (;;) {
+    InputSource::Span span = input.read(size_t{1} << 20, scratch);
+    if (span.size == 0) {
+      break;
+    }
+    add_sample(span.data, span.size);
+    input.release(span);
+  }
+}
+
+void SharedTable::train(int max_code_length) {
+  // Bytes missing from the samples still need a (long) code
+  std::map<uint8_t, uint64_t> frequencies;
+  for (size_t byte = 0; byte < counts_.size(); ++byte) {
+    frequencies[static_cast<uint8_t>(byte)] =
+        std::max<uint64_t>(counts_[byte], 1);
+  }
+  assign(HuffmanTree::limited_code_lengths(frequencies, max_code_length));
+}
+
+void SharedTable::assign(const CanonicalCode::Lengths& lengths) {
+  if (std::find(lengths.begin(), lengths.end(), 0) != lengths.end()) {
+    throw std::runtime_error("SharedTable: Table does not cover every byte");
+  }
+  code_.assign(lengths);
+  decoder_.build(code_);
+
+  // FNV-1a over the lengths, which define the code completely
+  uint32_t hash = 2166136261u;
+  for (uint8_t length : lengths) {
+    hash = (hash ^ length) * 16777619u;
+  }
+  id_ = hash;
+  ready_ = true;
+}
+
+void SharedTable::serialize(std::vector<uint8_t>& out) const {
+  if (!ready_) {
+    throw std::runtime_error("SharedTable: Table has not been trained");
+  }
+  out.insert(out.end(), kTableMagic, kTableMagic + 4);
+  out.push_back(kTableVersion);
+  append_u32(out, id_);
+  code_.serialize(out);
+}
+
+void SharedTable::deserialize(const uint8_t* in, size_t size) {
+  if (size < kTableHeaderSize ||
+      !std::equal(kTableMagic, kTableMagic + 4, in)) {
+    throw std::runtime_error("SharedTable: Not a table file");
+  }
+  if (in[4] != kTableVersion) {
+    throw std::runtime_error("SharedTable: Unsupported table version: " +
+                             std::to_string(in[4]));
+  }
+
+  CanonicalCode code;
+  code.deserialize(in + kTableHeaderSize, size - kTableHeaderSize);
+  assign(code.lengths());
+  if (id_ != load_u32(in + 5)) {
+    throw std::runtime_error("SharedTable: Table ID does not match contents");
+  }
+}
+
+void SharedTable::save(const std::string& file_name) const {
+  std::vector<uint8_t> bytes;
+  serialize(bytes);
+
+  std::ofstream output(file_name, std::ios::binary);
+  if (!output.is_open()) {
+    throw std::runtime_error("Could not open output file: " + file_name);
+  }
+  output.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  output.close();
+  if (!output) {
+    throw std::runtime_error("Failed to write output file: " + file_name);
+  }
+}
+
+void SharedTable::load(const std::string& file_name) {
+  std::ifstream input(file_name, std::ios::binary);
+  if (!input.is_open()) {
+    throw std::runtime_error("Could not open table file: " + file_name);
+  }
+  std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(input)),
+                             std::istreambuf_iterator<char>());
+  deserialize(bytes.data(), bytes.size());
+}
+
+std::string SharedTable::format_id(uint32_t id) {
+  std::ostringstream text;
+  text << std::hex << std::setw(8) << std::setfill('0') << id;
+  return text.str();
+}
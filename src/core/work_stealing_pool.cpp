@@ -0,0 +1,125 @@
+#include "core/work_stealing_pool.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// Set on the pool's own threads so submit() can find the caller's deque
+thread_local const WorkStealingPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(size_t num_threads) {
+  if (num_threads == 0) {
+    throw std::invalid_argument("WorkStealingPool: Need at least one thread");
+  }
+
+  for (size_t i = 0; i < num_threads; ++i) {
+    deques_.push_back(std::make_unique<Deque>());
+  }
+  workers_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this, i] { worker_loop(i); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  task_available_.notify_all();
+
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void WorkStealingPool::submit(Task task) {
+  {
+    // Pushed under mutex_ so queued_ never falls behind the deques
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t target = current_pool == this ? current_worker
+                                         : next_deque_++ % deques_.size();
+    Deque& deque = *deques_[target];
+    {
+      std::lock_guard<std::mutex> deque_lock(deque.mutex);
+      deque.tasks.push_back(std::move(task));
+    }
+    ++queued_;
+    ++pending_;
+  }
+  task_available_.notify_one();
+}
+
+void WorkStealingPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  all_done_.wait(lock, [this] { return pending_ == 0; });
+  if (error_) {
+    std::exception_ptr error = std::exchange(error_, nullptr);
+    std::rethrow_exception(error);
+  }
+}
+
+bool WorkStealingPool::take(size_t worker, Task& task) {
+  {
+    Deque& own = *deques_[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  // Start with the next worker along so thieves spread over the victims
+  for (size_t i = 1; i < deques_.size(); ++i) {
+    Deque& victim = *deques_[(worker + i) % deques_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::worker_loop(size_t worker) {
+  current_pool = this;
+  current_worker = worker;
+
+  for (;;) {
+    Task task;
+    if (!take(worker, task)) {
+      // queued_ may still count a task another worker just took; that only
+      // means one more look round the deques
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_available_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+      if (queued_ == 0) {
+        return;  // Stopping and nothing left to run
+      }
+      continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --queued_;
+    }
+    try {
+      task(worker);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--pending_ == 0) {
+      all_done_.notify_all();
+    }
+  }
+}
@@ -1,22 +1,54 @@
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <string>
+#include <vector>
 
-#include "core/bit_stream.hpp"    // Adding include for BitStream
-#include "core/encoder.hpp"       // Adding include for Encoder
-#include "core/huffman_tree.hpp"  // Adding include for HuffmanTree
+#include "core/batch_encoder.hpp"
+#include "core/encoder.hpp"
+#include "core/parse_number.hpp"
+#include "core/shared_table.hpp"
 
 struct Arguments {
   void printHelp() const {
     std::cout
         << "Usage: quickcompress [options]\n"
+        << "       quickcompress -c|-d [options] <files or directories...>\n"
+        << "       quickcompress train -o <table> [-l <n>] <samples...>\n"
         << "Options:\n"
         << "  -c, --compress       Compress the input file\n"
         << "  -d, --decompress     Decompress the input file\n"
-        << "  -i, --input <file>   Input file path\n"
-        << "  -o, --output <file>  Output file path\n"
-        << "  -v, --verbose        Enable verbose output\n"
+        << "  -i, --input <file>   Input file path, - for standard input\n"
+        << "  -o, --output <file>  Output file path, - for standard output\n"
+        << "  -v, --verbose        Enable verbose output, with --stats\n"
+        << "      --stats [json]   Time per stage, ratio and bits/symbol,\n"
+        << "                       as text or as one JSON object\n"
+        << "  -q, --quiet          No progress bar (also off unless standard\n"
+        << "                       error is a terminal)\n"
         << "  -h, --help           Show this help message\n"
-        << "  -t, --threads <num>  Number of threads to use (default: 1)\n";
+        << "  -t, --threads <num>  Number of threads to use (default: 1)\n"
+        << "  -b, --buffer <KiB>   Legacy-format decode buffer size\n"
+        << "                       (default: 1024)\n"
+        << "  -s, --block <KiB>    Compression block size (default: 1024)\n"
+        << "  -l, --max-bits <n>   Longest Huffman code, 0 = unbounded\n"
+        << "                       (default: 0, 8..64 otherwise)\n"
+        << "  -T, --table <file>   Code with a table from 'train', which is\n"
+        << "                       also needed to decompress the result\n"
+        << "  -x, --context        Also try order-1 (previous byte) tables\n"
+        << "                       and keep them for blocks they shrink\n"
+        << "  -r, --range <o>:<n>  With -d, decompress only the original\n"
+        << "                       bytes [o, o + n); reads only their blocks\n"
+        << "  -f, --force          In batch mode, replace existing outputs\n"
+        << "                       instead of failing those files\n"
+        << "Batch mode:\n"
+        << "  Files and directories (recursively) named without -i are\n"
+        << "  coded together on --threads workers, each output next to its\n"
+        << "  input: <file>.qcmp, or <file> again from <file>.qcmp\n"
+        << "Commands:\n"
+        << "  train                Build a shared table from sample files or\n"
+        << "                       directories; -l caps codes (default: 15)\n";
   }
   // This struct will hold information about command line arguments:
   // If it is compression or decompression,
@@ -26,9 +58,35 @@ struct Arguments {
   std::string outputFile;      // Output file path
   bool verbose = false;        // Verbose mode for detailed output
   bool help = false;           // Show help message
+  bool invalid = false;        // a usage error was reported
   int numThreads = 1;  // Number of threads to use for compression/decompression
+  size_t bufferSize = Encoder::kDefaultBufferSize;  // Legacy decode buffer
+  size_t blockSize = Encoder::kDefaultBlockSize;    // Block size in bytes
+  int maxCodeLength = 0;  // Huffman code length limit, 0 for unbounded
+  bool isTraining = false;               // train a shared table instead
+  std::vector<std::string> sampleFiles;  // training corpus
+  std::string tableFile;                 // shared table to use
+  bool contextMode = false;              // try order-1 tables per block
+  bool hasRange = false;                 // decompress a byte range only
+  uint64_t rangeOffset = 0;              // first original byte of the range
+  uint64_t rangeLength = 0;              // bytes in the range
+  std::string statsFormat;               // "text" or "json", empty for none
+  bool quiet = false;                    // no progress bar
+  bool force = false;                    // batch mode replaces outputs
+  std::vector<std::string> batchInputs;  // files and directories to code
 };
 
+// A size given in KiB, in bytes
+bool parse_kib(const std::string& text, size_t& bytes) {
+  size_t kib = 0;
+  if (!parse_number(text, kib) ||
+      kib > std::numeric_limits<size_t>::max() / 1024) {
+    return false;
+  }
+  bytes = kib * 1024;
+  return true;
+}
+
 Arguments parse_arguments(int argc, char* argv[]) {
   Arguments args;
 
@@ -44,143 +102,307 @@ Arguments parse_arguments(int argc, char* argv[]) {
         args.inputFile = argv[++i];
       } else {
         std::cerr << "Error: No input file specified.\n";
-        args.help = true;
+        args.invalid = true;
       }
     } else if (arg == "-o" || arg == "--output") {
       if (i + 1 < argc) {
         args.outputFile = argv[++i];
       } else {
         std::cerr << "Error: No output file specified.\n";
-        args.help = true;
+        args.invalid = true;
       }
     } else if (arg == "-v" || arg == "--verbose") {
       args.verbose = true;
+    } else if (arg == "-q" || arg == "--quiet") {
+      args.quiet = true;
+    } else if (arg == "-f" || arg == "--force") {
+      args.force = true;
     } else if (arg == "-h" || arg == "--help") {
       args.help = true;
     } else if (arg == "-t" || arg == "--threads") {
+      if (i + 1 >= argc) {
+        std::cerr << "Error: No number of threads specified.\n";
+        args.invalid = true;
+      } else if (!parse_number(argv[++i], args.numThreads)) {
+        std::cerr << "Error: Invalid number of threads '" << argv[i] << "'.\n";
+        args.invalid = true;
+      }
+    } else if (arg == "-b" || arg == "--buffer") {
+      if (i + 1 >= argc) {
+        std::cerr << "Error: No buffer size specified.\n";
+        args.invalid = true;
+      } else if (!parse_kib(argv[++i], args.bufferSize)) {
+        std::cerr << "Error: Invalid buffer size '" << argv[i] << "'.\n";
+        args.invalid = true;
+      }
+    } else if (arg == "-s" || arg == "--block") {
+      if (i + 1 >= argc) {
+        std::cerr << "Error: No block size specified.\n";
+        args.invalid = true;
+      } else if (!parse_kib(argv[++i], args.blockSize)) {
+        std::cerr << "Error: Invalid block size '" << argv[i] << "'.\n";
+        args.invalid = true;
+      }
+    } else if (arg == "-l" || arg == "--max-bits") {
+      if (i + 1 >= argc) {
+        std::cerr << "Error: No code length limit specified.\n";
+        args.invalid = true;
+      } else if (!parse_number(argv[++i], args.maxCodeLength)) {
+        std::cerr << "Error: Invalid code length limit '" << argv[i]
+                  << "'.\n";
+        args.invalid = true;
+      }
+    } else if (arg == "-T" || arg == "--table") {
       if (i + 1 < argc) {
-        args.numThreads = std::stoi(argv[++i]);
+        args.tableFile = argv[++i];
       } else {
-        std::cerr << "Error: No number of threads specified.\n";
-        args.help = true;
+        std::cerr << "Error: No table file specified.\n";
+        args.invalid = true;
+      }
+    } else if (arg == "-x" || arg == "--context") {
+      args.contextMode = true;
+    } else if (arg == "-r" || arg == "--range") {
+      std::string range = i + 1 < argc ? argv[++i] : "";
+      size_t colon = range.find(':');
+      if (colon != std::string::npos &&
+          parse_number(range.substr(0, colon), args.rangeOffset) &&
+          parse_number(range.substr(colon + 1), args.rangeLength)) {
+        args.hasRange = true;
+      } else {
+        std::cerr << "Error: Range must be <offset>:<length>, each a number "
+                     "of bytes.\n";
+        args.invalid = true;
+      }
+    } else if (arg == "--stats") {
+      args.statsFormat = "text";
+      if (i + 1 < argc && (std::string(argv[i + 1]) == "text" ||
+                           std::string(argv[i + 1]) == "json")) {
+        args.statsFormat = argv[++i];
       }
+    } else if (arg == "train" && i == 1) {
+      args.isTraining = true;
+      args.maxCodeLength = SharedTable::kDefaultMaxCodeLength;
+    } else if (args.isTraining && arg[0] != '-') {
+      args.sampleFiles.push_back(arg);
+    } else if (arg[0] != '-') {
+      args.batchInputs.push_back(arg);
     } else {
       std::cerr << "Error: Unknown argument '" << arg << "'\n";
-      args.help = true;
+      args.invalid = true;
     }
   }
 
   return args;
 }
 
-int main(int argc, char* argv[]) {
-  std::cout << "Hello World from QuickCompress!\n";
-
-  // Test BitStream
-  std::cout << "\n=== BitStream Test ===\n";
-  BitStream bs;
-
-  // Test write_bit
-  /*
-  bs.write_bit(true);
-  bs.write_bit(false);
-  bs.write_bit(true);
-  bs.write_bit(true);
-  */
-  // Test write_bits
-  bs.write_bits(0xA5, 8);  // 10100101
-
-  std::cout << "BitStream size: " << bs.size() << " bits\n";
-
-  // Test get_buffer
-  auto buffer = bs.get_buffer();
-  std::cout << "Buffer contents: ";
-  for (auto byte : buffer) {
-    std::cout << std::hex << "0x" << static_cast<int>(byte) << " ";
+// Count every sample (directories recursively) and save the trained table
+int train_table(const Arguments& args) {
+  if (args.outputFile.empty() || args.sampleFiles.empty()) {
+    std::cerr << "Error: train needs -o <table> and at least one sample.\n";
+    return 1;
   }
-  std::cout << std::dec << "\n";
 
-  // Test HuffmanTree edge case
-  std::cout << "\n=== HuffmanTree Edge Case Test ===\n";
-  HuffmanTree huffman;
+  try {
+    SharedTable table;
+    size_t num_files = 0;
+    uint64_t num_bytes = 0;
+    auto add_file = [&](const std::filesystem::path& path) {
+      table.add_sample_file(path.string());
+      ++num_files;
+      num_bytes += std::filesystem::file_size(path);
+    };
 
-  // Test single character case (edge case)
-  std::map<uint8_t, uint64_t> single_char_freq;
-  single_char_freq[65] = 100;  // 'A' appears 100 times
+    for (const auto& sample : args.sampleFiles) {
+      if (std::filesystem::is_directory(sample)) {
+        for (const auto& entry :
+             std::filesystem::recursive_directory_iterator(sample)) {
+          if (entry.is_regular_file()) {
+            add_file(entry.path());
+          }
+        }
+      } else {
+        add_file(sample);
+      }
+    }
 
-  try {
-    huffman.build_tree(single_char_freq);
-    auto codes = huffman.generate_codes();
-    std::cout << "Single character test successful!\n";
-    std::cout << "Character 'A' (65) gets code: '" << codes[65] << "'\n";
+    table.train(args.maxCodeLength ? args.maxCodeLength
+                                   : SharedTable::kDefaultMaxCodeLength);
+    table.save(args.outputFile);
+    std::cout << "Trained table " << SharedTable::format_id(table.id())
+              << " from " << num_files << " files (" << num_bytes
+              << " bytes) -> '" << args.outputFile << "'\n";
   } catch (const std::exception& e) {
-    std::cout << "Single character test failed: " << e.what() << "\n";
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
   }
+  return 0;
+}
 
-  // Test multiple characters case (normal case)
-  std::map<uint8_t, uint64_t> multi_char_freq;
-  multi_char_freq[65] = 10;  // 'A'
-  multi_char_freq[66] = 20;  // 'B'
-  multi_char_freq[67] = 30;  // 'C'
+// Code every named file and directory tree in one run, outputs next to
+// their inputs; messages go to console and statistics to report
+int run_batch(const Arguments& args, std::ostream& console,
+              std::ostream& report) {
+  if (!args.inputFile.empty() || !args.outputFile.empty() || args.hasRange) {
+    std::cerr << "Error: Batch mode writes each output next to its input "
+                 "and takes no -i, -o or -r.\n";
+    return 1;
+  }
 
   try {
-    huffman.build_tree(multi_char_freq);
-    auto codes = huffman.generate_codes();
-    std::cout << "Multiple character test successful!\n";
-    std::cout << "Generated codes:\n";
-    for (const auto& pair : codes) {
-      std::cout << "  Character " << static_cast<char>(pair.first) << " ("
-                << static_cast<int>(pair.first) << "): '" << pair.second
-                << "'\n";
+    BatchEncoder batch(args.numThreads);
+    batch.set_collect_stats(!args.statsFormat.empty());
+    batch.set_show_progress(!args.quiet);
+    batch.set_overwrite(args.force);
+    batch.set_block_size(args.blockSize);
+    batch.set_max_code_length(args.maxCodeLength);
+    batch.set_context_mode(args.contextMode);
+    if (!args.tableFile.empty()) {
+      auto table = std::make_shared<SharedTable>();
+      table->load(args.tableFile);
+      batch.set_shared_table(table);
+    }
+
+    std::vector<std::string> inputs =
+        BatchEncoder::collect_inputs(args.batchInputs, args.isCompression);
+    console << "\n" << (args.isCompression ? "Compressing " : "Decompressing ")
+            << inputs.size()
+            << (inputs.size() == 1 ? " file on " : " files on ")
+            << args.numThreads
+            << (args.numThreads == 1 ? " thread\n" : " threads\n");
+    BatchEncoder::Result result = args.isCompression
+                                      ? batch.compress(inputs)
+                                      : batch.decompress(inputs);
+
+    for (const auto& failure : result.failures) {
+      std::cerr << "Error: " << failure << "\n";
+    }
+    const CodecStats& stats = result.stats;
+    console << (args.isCompression ? "Compressed " : "Decompressed ")
+            << result.files << (result.files == 1 ? " file, " : " files, ")
+            << stats.original_bytes
+            << " bytes " << (args.isCompression ? "-> " : "<- ")
+            << stats.compressed_bytes << " bytes (ratio " << stats.ratio()
+            << ") in " << stats.wall_seconds << " s, "
+            << result.failures.size() << " failed\n";
+    if (args.statsFormat == "json") {
+      stats.print_json(report);
+    } else if (!args.statsFormat.empty()) {
+      stats.print_text(report);
     }
+    return result.failures.empty() ? 0 : 1;
   } catch (const std::exception& e) {
-    std::cout << "Multiple character test failed: " << e.what() << "\n";
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
   }
+}
 
+int main(int argc, char* argv[]) {
   // Parse command line arguments
   Arguments args = parse_arguments(argc, argv);
+  if (args.verbose && args.statsFormat.empty()) {
+    args.statsFormat = "text";
+  }
 
-  // If help is needed, display it
-  if (args.help) {
+  // With -o -, standard output carries the data, so messages go to
+  // standard error. With --stats json the JSON object is all they print.
+  std::ostream& report = args.outputFile == "-" ? std::cerr : std::cout;
+  std::ostream discard(nullptr);
+  std::ostream& console = args.statsFormat == "json" ? discard : report;
+
+  // If help is needed, display it; after a usage error, fail
+  if (args.help || args.invalid) {
     args.printHelp();
-    return 0;
+    return args.invalid ? 1 : 0;
   }
 
   // Show parsed arguments
-  std::cout << "\n=== Parsed Arguments ===\n";
-  std::cout << "Mode: "
-            << (args.isCompression ? "Compression" : "Decompression") << "\n";
-  std::cout << "Input file: "
-            << (args.inputFile.empty() ? "<not specified>" : args.inputFile)
-            << "\n";
-  std::cout << "Output file: "
-            << (args.outputFile.empty() ? "<not specified>" : args.outputFile)
-            << "\n";
-  std::cout << "Threads: " << args.numThreads << "\n";
-  std::cout << "Verbose: " << (args.verbose ? "enabled" : "disabled") << "\n";
+  console << "\n=== Parsed Arguments ===\n";
+  console << "Mode: "
+          << (args.isTraining      ? "Training"
+              : args.isCompression ? "Compression"
+                                   : "Decompression")
+          << "\n";
+  if (!args.batchInputs.empty()) {
+    console << "Batch inputs: " << args.batchInputs.size() << "\n";
+  }
+  console << "Input file: "
+          << (args.inputFile.empty() ? "<not specified>" : args.inputFile)
+          << "\n";
+  console << "Output file: "
+          << (args.outputFile.empty() ? "<not specified>" : args.outputFile)
+          << "\n";
+  console << "Threads: " << args.numThreads << "\n";
+  console << "Legacy decode buffer: " << args.bufferSize / 1024 << " KiB\n";
+  console << "Block size: " << args.blockSize / 1024 << " KiB\n";
+  console << "Max code length: "
+          << (args.maxCodeLength ? std::to_string(args.maxCodeLength)
+                                 : std::string("unbounded"))
+          << "\n";
+  console << "Shared table: "
+          << (args.tableFile.empty() ? "<none>" : args.tableFile) << "\n";
+  console << "Context mode: " << (args.contextMode ? "order-1" : "off") << "\n";
+  if (args.hasRange) {
+    console << "Range: " << args.rangeLength << " bytes at "
+            << args.rangeOffset << "\n";
+  }
+  console << "Verbose: " << (args.verbose ? "enabled" : "disabled") << "\n";
 
   // Example logic based on arguments
-  if (args.inputFile.empty()) {
-    std::cout << "\nWarning: No input file specified!\n";
+  if (args.isTraining) {
+    console << "\n";
+    if (int status = train_table(args)) {
+      return status;
+    }
+  } else if (!args.batchInputs.empty()) {
+    if (int status = run_batch(args, console, report)) {
+      return status;
+    }
+  } else if (args.inputFile.empty()) {
+    console << "\nWarning: No input file specified!\n";
   } else {
     Encoder encoder;
     try {
+      encoder.set_collect_stats(!args.statsFormat.empty());
+      encoder.set_show_progress(!args.quiet);
+      encoder.set_buffer_size(args.bufferSize);
+      encoder.set_block_size(args.blockSize);
+      encoder.set_num_threads(args.numThreads);
+      encoder.set_max_code_length(args.maxCodeLength);
+      encoder.set_context_mode(args.contextMode);
+      if (!args.tableFile.empty()) {
+        auto table = std::make_shared<SharedTable>();
+        table->load(args.tableFile);
+        encoder.set_shared_table(table);
+      }
       if (args.isCompression) {
-        std::cout << "\nCompressing file '" << args.inputFile << "'";
+        console << "\nCompressing file '" << args.inputFile << "'";
         if (!args.outputFile.empty()) {
-          std::cout << " -> '" << args.outputFile << "'";
+          console << " -> '" << args.outputFile << "'";
         }
-        std::cout << "\n";
+        console << "\n";
         encoder.compress(args.inputFile, args.outputFile);
-        std::cout << "Compression completed successfully!\n";
+        console << "Compression completed successfully!\n";
       } else {
-        std::cout << "\nDecompressing file '" << args.inputFile << "'";
+        console << "\nDecompressing file '" << args.inputFile << "'";
         if (!args.outputFile.empty()) {
-          std::cout << " -> '" << args.outputFile << "'";
+          console << " -> '" << args.outputFile << "'";
+        }
+        console << "\n";
+        if (args.hasRange) {
+          uint64_t written = encoder.decompress_range(
+              args.inputFile, args.outputFile, args.rangeOffset,
+              args.rangeLength);
+          console << "Decompressed " << written << " bytes of the range\n";
+        } else {
+          encoder.decompress(args.inputFile, args.outputFile);
         }
-        std::cout << "\n";
-        encoder.decompress(args.inputFile, args.outputFile);
-        std::cout << "Decompression completed successfully!\n";
+        console << "Decompression completed successfully!\n";
+      }
+
+      if (args.statsFormat == "json") {
+        encoder.stats().print_json(report);
+      } else if (!args.statsFormat.empty()) {
+        encoder.stats().print_text(report);
       }
     } catch (const std::exception& e) {
       std::cerr << "Error: " << e.what() << "\n";
@@ -189,12 +411,12 @@ int main(int argc, char* argv[]) {
   }
 
   if (args.verbose) {
-    std::cout << "\n=== Verbose Info ===\n";
-    std::cout << "Program name: " << argv[0] << "\n";
-    std::cout << "Total arguments: " << argc << "\n";
-    std::cout << "Raw arguments:\n";
+    console << "\n=== Verbose Info ===\n";
+    console << "Program name: " << argv[0] << "\n";
+    console << "Total arguments: " << argc << "\n";
+    console << "Raw arguments:\n";
     for (int i = 1; i < argc; ++i) {
-      std::cout << "  " << i << ": " << argv[i] << "\n";
+      console << "  " << i << ": " << argv[i] << "\n";
     }
   }
 